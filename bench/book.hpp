@@ -0,0 +1,255 @@
+/**
+ * @file book.hpp
+ * @brief Synthetic journal books and the common helpers of the benchmarks
+ * @internal
+ *
+ * This file is part of Skyrim SE Journal mod (aka Journal).
+ *
+ *   Journal is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Journal is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Journal. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Benchmarks
+ *
+ * @details
+ * The books follow the schema of the JSON books saved by src/fileio.cpp, with the page texts made
+ * of journal like prose from a fixed seed, so that the runs are comparable.
+ */
+
+#ifndef BENCH_BOOK_HPP
+#define BENCH_BOOK_HPP
+
+#include <nlohmann/json.hpp>
+#include <utils/jsonwriter.hpp>
+#include <utils/jsonbook.hpp>
+#include <utils/mapfile.hpp>
+#include <utils/text.hpp>
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <cstdio>
+#include <cstdint>
+#include <ostream>
+#include <stdexcept>
+#include <filesystem>
+
+//--------------------------------------------------------------------------------------------------
+
+struct bench_image_t
+{
+    bool background = false;
+    std::uint32_t tint = 0xffffffff;
+    std::array<float, 4> uv = {{ 0, 0, 1, 1 }}, xy = {{ 0, 0, 1, 1 }};
+};
+
+/// The parts of page_t which the books keep, so that json_book_sax loads it as it loads page_t
+struct bench_page_t
+{
+    bench_page_t () = default;
+    explicit bench_page_t (std::pmr::memory_resource* texts) : title (texts), content (texts) {}
+
+    text_buffer title, content;
+    bench_image_t image;
+    std::string image_file;
+};
+
+struct bench_book_t
+{
+    std::unique_ptr<text_store_t> texts;    ///< Of the loaded books, outlives the pages
+    unsigned current = 0;
+    std::vector<bench_page_t> pages;
+};
+
+//--------------------------------------------------------------------------------------------------
+
+/// About 150-2500 bytes of prose per page, some of it past ASCII, as the players do write
+inline std::string
+bench_prose (std::mt19937& rng, std::size_t words)
+{
+    static const char* vocabulary[] = {
+        "the", "of", "and", "to", "a", "in", "was", "Jarl", "Whiterun", "Dragonsreach", "dragon",
+        "Ulfric", "Stormcloak", "Imperial", "Legion", "Riften", "Thieves", "Guild", "Solitude",
+        "Markarth", "I", "we", "found", "walked", "along", "road", "river", "north", "bandits",
+        "camp", "sword", "shield", "potion", "soul", "gem", "shout", "Thu'um", "Greybeards",
+        "High", "Hrothgar", "Dovahkiin", "barrow", "draugr", "Ysgramor", "Jørgen", "Élisif",
+        "Þórr", "København", "Привет", "гора", "снег", "after", "before", "night", "morning",
+        "gold", "septims", "wolf", "bear", "giant", "mammoth", "cheese", "sweetroll", "arrow",
+        "knee", "guard", "quest", "letter", "courier", "Skyrim", "Tamriel", "Nord", "Dunmer",
+    };
+    std::uniform_int_distribution<std::size_t> word (0, std::size (vocabulary) - 1);
+    std::uniform_int_distribution<int> stop (0, 11);
+
+    std::string s;
+    s.reserve (words * 8);
+    for (std::size_t i = 0; i < words; ++i)
+    {
+        s += vocabulary[word (rng)];
+        int c = stop (rng);
+        s += c == 0 ? ".\n" : c == 1 ? ", " : " ";
+    }
+    return s;
+}
+
+inline bench_book_t
+bench_book (std::size_t pages, unsigned seed = 2077)
+{
+    std::mt19937 rng (seed);
+    std::uniform_int_distribution<std::size_t> words (20, 400);
+    bench_book_t book;
+    book.pages.resize (pages);
+    for (std::size_t i = 0; i < pages; ++i)
+    {
+        auto& p = book.pages[i];
+        p.title = "Day " + std::to_string (i + 1) + ": " + bench_prose (rng, 3);
+        p.content = bench_prose (rng, words (rng));
+        if (i % 7 == 0)
+        {
+            p.image_file = "images/page" + std::to_string (i) + ".dds";
+            p.image.background = i % 2;
+            p.image.tint = 0xff80c0ff;
+            p.image.uv = { .1f, .2f, .9f, .8f };
+        }
+    }
+    book.current = unsigned (pages / 2);
+    return book;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+inline std::string
+bench_hex (std::uint32_t v)
+{
+    char s[16];
+    std::snprintf (s, sizeof (s), "0x%08x", v);
+    return s;
+}
+
+/// As write_json_book () does
+inline void
+bench_write_json (bench_book_t const& book, std::ostream& os, bool pretty)
+{
+    json_writer json (os, pretty);
+    json.begin_object ();
+    json.begin_object ("version");
+    json.member ("major", 1);
+    json.member ("minor", 0);
+    json.member ("patch", 0);
+    json.member ("timestamp", "2026-01-01T00:00:00");
+    json.end_object ();
+    json.member ("size", book.pages.size ());
+    json.member ("current", book.current);
+    json.begin_object ("pages");
+    for (std::size_t i = 0; i < book.pages.size (); ++i)
+    {
+        auto const& p = book.pages[i];
+        json.begin_object (std::to_string (i));
+        json.member ("title", p.title.view ());
+        json.member ("content", p.content.view ());
+        json.begin_object ("image");
+        json.member ("file", p.image_file);
+        json.member ("background", p.image.background);
+        json.member ("tint", bench_hex (p.image.tint));
+        json.member ("uv", p.image.uv);
+        json.member ("xy", p.image.xy);
+        json.end_object ();
+        json.end_object ();
+    }
+    json.end_object ();
+    json.end_object ();
+    json.flush ();
+}
+
+/// As write_encoded_book () does, a DOM to be put through the CBOR or MessagePack writers
+inline nlohmann::json
+bench_dom (bench_book_t const& book)
+{
+    nlohmann::json json = {
+        { "version", { { "major", 1 }, { "minor", 0 }, { "patch", 0 },
+                       { "timestamp", "2026-01-01T00:00:00" } } },
+        { "size", book.pages.size () },
+        { "current", book.current },
+        { "pages", nlohmann::json::object () }
+    };
+    auto& pages = json["pages"];
+    for (std::size_t i = 0; i < book.pages.size (); ++i)
+    {
+        auto const& p = book.pages[i];
+        pages[std::to_string (i)] = {
+            { "title", std::string (p.title.view ()) },
+            { "content", std::string (p.content.view ()) },
+            { "image", {
+                { "file", p.image_file },
+                { "background", p.image.background },
+                { "tint", bench_hex (p.image.tint) },
+                { "uv", p.image.uv },
+                { "xy", p.image.xy }
+            }}
+        };
+    }
+    return json;
+}
+
+/// As load_json_book () does, through the same SAX handler and into the same text store
+inline bench_book_t
+bench_load (std::string const& path, nlohmann::detail::input_format_t format)
+{
+    mapped_file file (path);
+    bench_book_t book;
+    book.texts = std::make_unique<text_store_t> (file.size (), false);
+    json_book_sax<bench_page_t> sax (book.texts->resource);
+    if (!parse_json_book (file, format, 1, sax))
+        throw std::runtime_error ("Incompatible book version of " + path);
+    book.current = sax.current;
+    book.pages.reserve (sax.pages.size ());
+    for (auto& p: sax.pages)
+    {
+        p.page.image_file = std::move (p.image_file);
+        book.pages.emplace_back (std::move (p.page));
+    }
+    return book;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// Best of few runs in milliseconds, the first run warms up the caches and the allocator
+template<class F>
+double
+bench_time (F&& f, int runs = 5)
+{
+    double best = 1e300;
+    for (int i = 0; i < runs; ++i)
+    {
+        auto t0 = std::chrono::steady_clock::now ();
+        f ();
+        std::chrono::duration<double, std::milli> d = std::chrono::steady_clock::now () - t0;
+        if (d.count () < best)
+            best = d.count ();
+    }
+    return best;
+}
+
+inline std::filesystem::path
+bench_file (std::string const& name)
+{
+    return std::filesystem::temp_directory_path () / ("sse-journal-bench-" + name);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+#endif
+
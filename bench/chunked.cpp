@@ -0,0 +1,123 @@
+/**
+ * @file chunked.cpp
+ * @brief Random inserts, erases and reads of chunked_vector against std::vector
+ * @internal
+ *
+ * This file is part of Skyrim SE Journal mod (aka Journal).
+ *
+ *   Journal is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Journal is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Journal. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Benchmarks
+ *
+ * @details
+ * The elements are of the size of the journal pages. Up to 100k of them are inserted one by one
+ * at random positions, read in random order and then erased one by one at random positions. The
+ * std::vector, which moves half of the elements on each edit, is run on 100k elements only with
+ * --slow (about a minute).
+ *
+ * The chunks of 64 show the cost of the chunk start updates, which grow with the chunks count.
+ */
+
+#include "book.hpp"
+#include <utils/chunked.hpp>
+
+#include <stdexcept>
+#include <cstring>
+
+//--------------------------------------------------------------------------------------------------
+
+/// About a page_t: two texts, the image and the flags
+struct element_t
+{
+    std::string title, content;
+    std::array<float, 8> image {};
+    std::uint64_t id = 0;
+    std::uint32_t flags = 0;
+};
+
+struct result_t
+{
+    double insert, read, erase;
+    std::uint64_t check;
+};
+
+template<class Container>
+static result_t
+run (std::size_t n)
+{
+    std::mt19937 rng (2077);
+    std::vector<std::size_t> at (n), reads (n);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        at[i] = std::uniform_int_distribution<std::size_t> (0, i) (rng);
+        reads[i] = std::uniform_int_distribution<std::size_t> (0, n - 1) (rng);
+    }
+
+    result_t r {};
+    Container c;
+    r.insert = bench_time ([&] {
+        for (std::size_t i = 0; i < n; ++i)
+            c.insert (c.begin () + at[i], element_t { {}, {}, {}, i, 0 });
+    }, 1);
+    r.read = bench_time ([&] {
+        for (auto i: reads)
+            r.check += c[i].id;
+    }, 1);
+    r.erase = bench_time ([&] {
+        for (std::size_t i = n; i; --i)
+        {
+            r.check = r.check * 31 + c[at[i-1]].id;
+            c.erase (c.begin () + at[i-1]);
+        }
+    }, 1);
+    if (!c.empty ())
+        throw std::runtime_error ("Not all erased");
+    return r;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+int
+main (int argc, char** argv)
+{
+    bool slow = argc >= 2 && !std::strcmp (argv[1], "--slow");
+
+    std::printf ("%8s  %-28s %12s %12s %12s\n", "elements", "container", "insert ms", "read ms",
+            "erase ms");
+    for (std::size_t n: { 1000, 10000, 100000 })
+    {
+        auto print = [n] (const char* name, result_t const& r) {
+            std::printf ("%8zu  %-28s %12.3f %12.3f %12.3f\n", n, name, r.insert, r.read, r.erase);
+        };
+        auto c = run<chunked_vector<element_t>> (n);
+        print ("chunked_vector", c);
+        auto c64 = run<chunked_vector<element_t, 64>> (n);
+        print ("chunked_vector, 64 a chunk", c64);
+        if (c.check != c64.check)
+            throw std::runtime_error ("The containers differ");
+        if (n <= 10000 || slow)
+        {
+            auto v = run<std::vector<element_t>> (n);
+            print ("std::vector", v);
+            if (v.check != c.check)
+                throw std::runtime_error ("The containers differ");
+        }
+    }
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+
@@ -0,0 +1,103 @@
+/**
+ * @file formats.cpp
+ * @brief Write time, parse time and size of the JSON, CBOR and MessagePack books
+ * @internal
+ *
+ * This file is part of Skyrim SE Journal mod (aka Journal).
+ *
+ *   Journal is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Journal is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Journal. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Benchmarks
+ *
+ * @details
+ * The writers are the ones of the game: json_writer for JSON, a DOM and the nlohmann encoders for
+ * the rest. All formats are loaded with the SAX handler of the game (@see bench_load), from a
+ * mapped file.
+ */
+
+#include "book.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <functional>
+#include <stdexcept>
+
+//--------------------------------------------------------------------------------------------------
+
+using nlohmann::detail::input_format_t;
+
+struct format_t
+{
+    const char* name;
+    input_format_t input;
+    std::function<void (bench_book_t const&, std::ostream&)> write;
+};
+
+static void
+write_file (format_t const& f, bench_book_t const& book, std::string const& path)
+{
+    std::ofstream of (path, std::ios::binary);
+    f.write (book, of);
+    of.close ();
+    if (!of)
+        throw std::runtime_error ("Writing " + path + " failed");
+}
+
+static std::size_t
+parse_file (format_t const& f, std::string const& path)
+{
+    return bench_load (path, f.input).pages.size ();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+int
+main ()
+{
+    const format_t formats[] = {
+        { "JSON pretty", input_format_t::json,
+            [] (auto const& b, auto& os) { bench_write_json (b, os, true); } },
+        { "JSON compact", input_format_t::json,
+            [] (auto const& b, auto& os) { bench_write_json (b, os, false); } },
+        { "CBOR", input_format_t::cbor,
+            [] (auto const& b, auto& os) { nlohmann::json::to_cbor (bench_dom (b), os); } },
+        { "MessagePack", input_format_t::msgpack,
+            [] (auto const& b, auto& os) { nlohmann::json::to_msgpack (bench_dom (b), os); } },
+    };
+
+    std::printf ("%8s  %-14s %12s %12s %12s\n", "pages", "format", "write ms", "parse ms", "bytes");
+    for (std::size_t n: { 10, 1000, 10000 })
+    {
+        auto book = bench_book (n);
+        for (auto const& f: formats)
+        {
+            auto path = bench_file ("formats").string ();
+            double write = bench_time ([&] { write_file (f, book, path); });
+            double parse = bench_time ([&] {
+                if (parse_file (f, path) != n)
+                    throw std::runtime_error (std::string ("Pages lost in ") + f.name);
+            });
+            auto size = std::filesystem::file_size (path);
+            std::printf ("%8zu  %-14s %12.3f %12.3f %12ju\n", n, f.name, write, parse,
+                    std::uintmax_t (size));
+            std::filesystem::remove (path);
+        }
+    }
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+
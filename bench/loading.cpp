@@ -0,0 +1,200 @@
+/**
+ * @file loading.cpp
+ * @brief Load time and peak heap of the JSON books, through a DOM versus through SAX
+ * @internal
+ *
+ * This file is part of Skyrim SE Journal mod (aka Journal).
+ *
+ *   Journal is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Journal is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Journal. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Benchmarks
+ *
+ * @details
+ * The "DOM" loader is the one before the SAX handler: the file streamed into a nlohmann::json,
+ * the pages copied out to a std::map for the sorting and then moved to the book. The "SAX" loader
+ * is json_book_sax of share/utils/jsonbook.hpp, as load_json_book () in src/fileio.cpp runs it:
+ * over a mapped file and into a text store of the file size (shelving off).
+ *
+ * The peak is of the heap only, counted through the global operator new, from the start of the
+ * load to its end. Kept are the pages, the text store included. The mapped file is not counted,
+ * its pages can be dropped by the OS at any time.
+ */
+
+#include "book.hpp"
+
+#include <map>
+#include <new>
+#include <fstream>
+#include <cstdlib>
+#include <stdexcept>
+
+//--------------------------------------------------------------------------------------------------
+
+static std::size_t heap_now = 0, heap_peak = 0;
+
+/// Each block is prefixed with its size, aligned as new would align it
+static constexpr std::size_t prefix = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+void*
+operator new (std::size_t n)
+{
+    auto p = static_cast<char*> (std::malloc (n + prefix));
+    if (!p)
+        throw std::bad_alloc ();
+    *reinterpret_cast<std::size_t*> (p) = n;
+    heap_now += n;
+    heap_peak = std::max (heap_peak, heap_now);
+    return p + prefix;
+}
+
+void
+operator delete (void* p) noexcept
+{
+    if (!p)
+        return;
+    auto b = static_cast<char*> (p) - prefix;
+    heap_now -= *reinterpret_cast<std::size_t*> (b);
+    std::free (b);
+}
+
+void operator delete (void* p, std::size_t) noexcept { operator delete (p); }
+
+/// The text store goes through these, as do all std::pmr::new_delete_resource () blocks
+void*
+operator new (std::size_t n, std::align_val_t a)
+{
+    auto align = std::max (std::size_t (a), prefix);
+    auto p = static_cast<char*> (std::aligned_alloc (align, (n + 2 * align - 1) / align * align));
+    if (!p)
+        throw std::bad_alloc ();
+    *reinterpret_cast<std::size_t*> (p + align - prefix) = n;
+    heap_now += n;
+    heap_peak = std::max (heap_peak, heap_now);
+    return p + align;
+}
+
+void
+operator delete (void* p, std::align_val_t a) noexcept
+{
+    if (!p)
+        return;
+    auto align = std::max (std::size_t (a), prefix);
+    auto b = static_cast<char*> (p) - align;
+    heap_now -= *reinterpret_cast<std::size_t*> (b + align - prefix);
+    std::free (b);
+}
+
+void
+operator delete (void* p, std::size_t, std::align_val_t a) noexcept
+{
+    operator delete (p, a);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static bench_book_t
+load_dom (std::string const& path)
+{
+    std::ifstream fi (path);
+    nlohmann::json json;
+    fi >> json;
+
+    bench_book_t book;
+    book.current = json["current"].get<unsigned> ();
+
+    std::map<int, bench_page_t> pages;
+    for (auto const& kv: json["pages"].items ())
+    {
+        bench_page_t p;
+        int ndx = std::stoi (kv.key ());
+        auto& v = kv.value ();
+        p.title = v["title"].get<std::string> ();
+        p.content = v["content"].get<std::string> ();
+        if (v.contains ("image"))
+        {
+            auto& vi = v["image"];
+            auto it = vi["uv"].begin ();
+            for (float& uv: p.image.uv) uv = *it++;
+            it = vi["xy"].begin ();
+            for (float& xy: p.image.xy) xy = *it++;
+            p.image.tint = std::uint32_t (std::stoull (vi["tint"].get<std::string> (), nullptr, 0));
+            p.image.background = vi["background"];
+            p.image_file = vi["file"];
+        }
+        pages.emplace (ndx, std::move (p));
+    }
+
+    book.pages.reserve (pages.size ());
+    for (auto& kv: pages)
+        book.pages.emplace_back (std::move (kv.second));
+    return book;
+}
+
+static bench_book_t
+load_sax (std::string const& path)
+{
+    return bench_load (path, nlohmann::detail::input_format_t::json);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+int
+main ()
+{
+    struct { std::size_t pages; std::size_t words; } books[] = {
+        { 10, 0 }, { 1000, 0 }, { 10000, 0 },
+        { 1000, 6000 },     // About 40 KB a page, 40 MB in total
+    };
+
+    std::printf ("%8s %12s  %-6s %12s %12s\n", "pages", "bytes", "loader", "load ms", "peak MB");
+    for (auto [n, words]: books)
+    {
+        auto book = bench_book (n);
+        if (words)
+        {
+            std::mt19937 rng (2077);
+            for (auto& p: book.pages)
+                p.content = bench_prose (rng, words);
+        }
+        auto path = bench_file ("loading.json").string ();
+        {
+            std::ofstream of (path, std::ios::binary);
+            bench_write_json (book, of, true);
+        }
+        auto bytes = std::filesystem::file_size (path);
+        book = {};
+
+        for (auto [name, load]: { std::pair { "DOM", &load_dom }, std::pair { "SAX", &load_sax } })
+        {
+            std::size_t peak = 0;
+            double ms = bench_time ([&] {
+                auto before = heap_now;
+                heap_peak = heap_now;
+                auto loaded = load (path);
+                peak = heap_peak - before;
+                if (loaded.pages.size () != n)
+                    throw std::runtime_error ("Pages lost");
+            });
+            std::printf ("%8zu %12ju  %-6s %12.3f %12.3f\n", n, std::uintmax_t (bytes), name, ms,
+                    peak / 1048576.);
+        }
+        std::filesystem::remove (path);
+    }
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+
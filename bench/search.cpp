@@ -0,0 +1,116 @@
+/**
+ * @file search.cpp
+ * @brief The substring search of share/utils/search.cpp against std::string_view::find
+ * @internal
+ *
+ * This file is part of Skyrim SE Journal mod (aka Journal).
+ *
+ *   Journal is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Journal is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Journal. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Benchmarks
+ *
+ * @details
+ * All matches are counted over 20 MB of journal prose. The case insensitive search is put against
+ * a find in a folded copy of the text, which is what it saves. The counts must agree.
+ */
+
+#include "book.hpp"
+#include <utils/search.hpp>
+#include <utils/utf8.hpp>
+
+#include <stdexcept>
+
+//--------------------------------------------------------------------------------------------------
+
+template<class Find>
+static std::size_t
+count (std::string_view text, std::string_view needle, Find&& find)
+{
+    std::size_t n = 0;
+    for (auto pos = find (text, needle, 0); pos != std::string_view::npos;
+            pos = find (text, needle, pos + 1))
+        ++n;
+    return n;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+int
+main ()
+{
+    std::mt19937 rng (2077);
+    std::string text;
+    while (text.size () < (20u << 20))
+        text += bench_prose (rng, 1000);
+
+    const char* needles[] = {
+        "Solitude",
+        "Sovngarde",
+        "Sovngarde is",
+        "the the the of the of the and the the",
+        "Jørgen",
+        "Привет гора",
+    };
+    const char* folded[] = {
+        "solitude",
+        "SOVNGARDE",
+        "dragonsreach, ",
+        "ПРИВЕТ",
+        "þórr",
+    };
+
+    std::printf ("%-40s %8s %14s %14s\n", "needle", "found", "find ms", "find_text ms");
+    for (std::string_view needle: needles)
+    {
+        std::size_t expected, found;
+        double std_find = bench_time ([&] {
+            expected = count (text, needle, [] (auto t, auto n, auto p) { return t.find (n, p); });
+        });
+        double find = bench_time ([&] {
+            found = count (text, needle,
+                    [] (auto t, auto n, auto p) { return find_text (t, n, p); });
+        });
+        if (found != expected)
+            throw std::runtime_error ("find_text differs for " + std::string (needle));
+        std::printf ("%-40.*s %8zu %14.3f %14.3f\n", int (needle.size ()), needle.data (), found,
+                std_find, find);
+    }
+
+    std::printf ("\n%-40s %8s %14s %14s\n", "needle, no case", "found", "fold+find ms",
+            "nocase ms");
+    for (std::string_view needle: folded)
+    {
+        std::size_t expected, found;
+        double std_find = bench_time ([&] {
+            auto t = fold_utf8 (text);
+            auto n = fold_utf8 (needle);
+            expected = count (t, n,
+                    [] (std::string_view t, auto n, auto p) { return t.find (n, p); });
+        });
+        double find = bench_time ([&] {
+            found = count (text, needle,
+                    [] (auto t, auto n, auto p) { return find_text_nocase (t, n, p); });
+        });
+        if (found != expected)
+            throw std::runtime_error ("find_text_nocase differs for " + std::string (needle));
+        std::printf ("%-40.*s %8zu %14.3f %14.3f\n", int (needle.size ()), needle.data (), found,
+                std_find, find);
+    }
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+
@@ -0,0 +1,186 @@
+/**
+ * @file takenotes.cpp
+ * @brief Import time of large Take Notes (FISS XML) files, by name lookups versus one pass
+ * @internal
+ *
+ * This file is part of Skyrim SE Journal mod (aka Journal).
+ *
+ *   Journal is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Journal is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Journal. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Benchmarks
+ *
+ * @details
+ * Usage:
+ *
+ *     takenotes                  1k, 5k and 50k entries, the lookups only up to 5k
+ *     takenotes --slow           the lookups on 50k entries too (minutes)
+ *     takenotes --write FILE [N] only writes a synthetic FISS file of N (50k) entries
+ *
+ * The "lookup" import is the one before the single pass: a first_node () by name for each date
+ * and entry, which scans the siblings from the start each time. The "one pass" import is
+ * takenotes_pages () of share/utils/takenotes.cpp, over a mapped file, as the game runs it.
+ */
+
+#include "book.hpp"
+#include <utils/takenotes.hpp>
+
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+//--------------------------------------------------------------------------------------------------
+
+using pages_t = std::vector<std::pair<std::string, std::string>>;
+
+/**
+ * FISS XML as the Take Notes mod saves it, but with the nodes shuffled (the lookups are slowest
+ * when the nodes are not in order), holes where every 97th entry is missing its body and an odd
+ * duplicated node, which should be ignored in favour of the first one.
+ */
+
+static void
+write_fiss (std::string const& path, std::size_t entries)
+{
+    std::mt19937 rng (2077);
+    std::uniform_int_distribution<std::size_t> words (10, 60);
+
+    std::vector<std::string> nodes;
+    nodes.reserve (entries * 2 + entries / 500);
+    for (std::size_t i = 1; i <= entries; ++i)
+    {
+        auto n = std::to_string (i);
+        nodes.push_back ("<date" + n + ">4E 201, " + n + " Last Seed</date" + n + ">");
+        if (i % 97)
+            nodes.push_back ("<entry" + n + ">" + bench_prose (rng, words (rng)) + "</entry" + n
+                    + ">");
+        if (i % 1000 == 0)
+            nodes.push_back ("<date" + n + ">Duplicate</date" + n + ">");
+    }
+    std::shuffle (nodes.begin (), nodes.end (), rng);
+
+    std::ofstream of (path, std::ios::binary);
+    of << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<fiss>\n<Header>\n"
+          "<Version>1.2</Version>\n</Header>\n<Data>\n<NumberOfEntries>" << entries
+       << "</NumberOfEntries>\n";
+    for (auto const& n: nodes)
+        of << n << '\n';
+    of << "</Data>\n</fiss>\n";
+    of.close ();
+    if (!of)
+        throw std::runtime_error ("Writing " + path + " failed");
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static rapidxml::xml_node<>*
+fiss_data (rapidxml::xml_document<>& doc, char* text, std::size_t& n)
+{
+    doc.parse<0> (text);
+    auto fiss = doc.first_node ("fiss");
+    if (!fiss) throw std::runtime_error ("No /fiss node");
+    auto data = fiss->first_node ("Data");
+    if (!data) throw std::runtime_error ("No /fiss/Data node");
+    auto noe = data->first_node ("NumberOfEntries");
+    if (!noe) throw std::runtime_error ("No /fiss/Data/NumberOfEntries node");
+    n = std::stoul (noe->value ());
+    return data;
+}
+
+static pages_t
+import_lookup (std::string const& path)
+{
+    std::ifstream fi (path, std::ios::binary);
+    std::string content { std::istreambuf_iterator<char> (fi), std::istreambuf_iterator<char> () };
+
+    rapidxml::xml_document<> doc;
+    std::size_t n;
+    auto data = fiss_data (doc, &content[0], n);
+
+    pages_t pages (n);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        auto num = std::to_string (i+1);
+        auto title = data->first_node (("date" + num).c_str ());
+        if (!title) continue;
+        auto entry = data->first_node (("entry" + num).c_str ());
+        if (!entry) continue;
+        pages[i].first = title->value ();
+        pages[i].second = entry->value ();
+    }
+    return pages;
+}
+
+static pages_t
+import_one_pass (std::string const& path)
+{
+    mapped_file file (path);
+    std::string copy;
+    rapidxml::xml_document<> doc;
+    auto nodes = takenotes_pages (file, copy, doc);
+    auto n = nodes.size ();
+
+    pages_t pages (n);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        auto [title, entry] = nodes[i];
+        if (!title || !entry) continue;
+        pages[i].first.assign (title->value (), title->value_size ());
+        pages[i].second.assign (entry->value (), entry->value_size ());
+    }
+    return pages;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+int
+main (int argc, char** argv)
+{
+    if (argc >= 3 && !std::strcmp (argv[1], "--write"))
+    {
+        write_fiss (argv[2], argc >= 4 ? std::stoul (argv[3]) : 50000);
+        return 0;
+    }
+    bool slow = argc >= 2 && !std::strcmp (argv[1], "--slow");
+
+    std::printf ("%8s %12s %14s %14s\n", "entries", "bytes", "lookup ms", "one pass ms");
+    for (std::size_t n: { 1000, 5000, 50000 })
+    {
+        auto path = bench_file ("takenotes.xml").string ();
+        write_fiss (path, n);
+
+        pages_t fast, slower;
+        double one_pass = bench_time ([&] { fast = import_one_pass (path); });
+        double lookup = -1;
+        if (n <= 5000 || slow)
+        {
+            lookup = bench_time ([&] { slower = import_lookup (path); }, 1);
+            if (slower != fast)
+                throw std::runtime_error ("The imports differ");
+        }
+        char skipped[16] = "skipped";
+        if (lookup >= 0)
+            std::snprintf (skipped, sizeof (skipped), "%.3f", lookup);
+        std::printf ("%8zu %12ju %14s %14.3f\n", n,
+                std::uintmax_t (std::filesystem::file_size (path)), skipped, one_pass);
+        std::filesystem::remove (path);
+    }
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+
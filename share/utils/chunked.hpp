@@ -0,0 +1,298 @@
+/**
+ * @file chunked.hpp
+ * @internal
+ *
+ * This file is part of General Utilities project (aka Utils).
+ *
+ *   Utils is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Utils is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Utils If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Utilities
+ *
+ * @details
+ * Sequence container for large and heavy elements, edited in the middle. The elements are
+ * allocated one by one (from a pool) and never move, only the pointers to them are kept in
+ * chunks of bounded size. Insert and erase shift the pointers of a single chunk and the chunk
+ * start indices, the random access is a binary search over these starts.
+ *
+ * Hence with n elements in chunks of N, an insert or erase costs O(N + n/N) and an access
+ * O(log (n/N)). The n/N part is a linear pass over a small array of start indices (200 to 400 at
+ * 100k elements with the default N), far cheaper than the chunk shift, so it is not worth a tree.
+ */
+
+#ifndef CHUNKED_HPP
+#define CHUNKED_HPP
+
+#include <vector>
+#include <memory>
+#include <memory_resource>
+#include <iterator>
+#include <utility>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Vector-like sequence, with references to the elements (i.e. handles) stable for their lifetime.
+ *
+ * Chunks hold up to @p N element pointers, a full one is split in halves and an emptied one is
+ * dropped. Iterators are invalidated by any insert or erase, the references only by erasing the
+ * element they refer to.
+ */
+
+template<class T, std::size_t N = 512>
+class chunked_vector
+{
+    std::vector<std::vector<T*>> chunks;
+    std::vector<std::size_t> starts;    ///< Index of the first element in each chunk
+    std::size_t count = 0;
+    std::uint64_t edits = 0;            ///< @see version()
+    std::unique_ptr<std::pmr::unsynchronized_pool_resource> nodes;
+
+    /// The chunk with the @p i-th element, or the last one past the end
+    std::size_t locate (std::size_t i) const
+    {
+        return std::size_t (std::upper_bound (starts.begin (), starts.end (), i) - starts.begin ())
+            - 1;
+    }
+
+    template<class... Args>
+    T* create (Args&&... args)
+    {
+        if (!nodes) nodes = std::make_unique<std::pmr::unsynchronized_pool_resource> ();
+        std::pmr::polymorphic_allocator<T> a (nodes.get ());
+        T* p = a.allocate (1);
+        try { ::new (static_cast<void*> (p)) T (std::forward<Args> (args)...); }
+        catch (...) { a.deallocate (p, 1); throw; }
+        return p;
+    }
+
+    void destroy (T* p)
+    {
+        p->~T ();
+        std::pmr::polymorphic_allocator<T> (nodes.get ()).deallocate (p, 1);
+    }
+
+    /// Linear in the chunks count, @see the file notes
+    void shift_starts (std::size_t k, std::ptrdiff_t n)
+    {
+        for (++k; k < starts.size (); ++k)
+            starts[k] += n;
+    }
+
+    template<bool Const>
+    class basic_iterator
+    {
+        friend class chunked_vector;
+        template<bool> friend class basic_iterator;
+        using owner_t = std::conditional_t<Const, chunked_vector const, chunked_vector>;
+        owner_t* v = nullptr;
+        std::size_t i = 0, k = 0;   ///< Element and its chunk
+
+        basic_iterator (owner_t* v, std::size_t i)
+            : v (v), i (i), k (v->chunks.empty () ? 0 : v->locate (i)) {}
+
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<Const, T const*, T*>;
+        using reference = std::conditional_t<Const, T const&, T&>;
+
+        basic_iterator () = default;
+        operator basic_iterator<true> () const { return { v, i }; }
+
+        reference operator* () const { return *v->chunks[k][i - v->starts[k]]; }
+        pointer operator-> () const { return &**this; }
+        reference operator[] (difference_type n) const { return *(*this + n); }
+
+        basic_iterator& operator++ ()
+        {
+            if (++i - v->starts[k] == v->chunks[k].size () && k + 1 < v->chunks.size ())
+                ++k;
+            return *this;
+        }
+        basic_iterator& operator-- ()
+        {
+            if (i-- == v->starts[k] && k)
+                --k;
+            return *this;
+        }
+        basic_iterator operator++ (int) { auto t = *this; ++*this; return t; }
+        basic_iterator operator-- (int) { auto t = *this; --*this; return t; }
+        basic_iterator& operator+= (difference_type n) { return *this = { v, i + n }; }
+        basic_iterator& operator-= (difference_type n) { return *this = { v, i - n }; }
+        basic_iterator operator+ (difference_type n) const { return { v, i + n }; }
+        basic_iterator operator- (difference_type n) const { return { v, i - n }; }
+        friend basic_iterator operator+ (difference_type n, basic_iterator it) { return it + n; }
+        difference_type operator- (basic_iterator const& o) const
+        {
+            return difference_type (i) - difference_type (o.i);
+        }
+        bool operator== (basic_iterator const& o) const { return i == o.i; }
+        auto operator<=> (basic_iterator const& o) const { return i <=> o.i; }
+    };
+
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using reference = T&;
+    using const_reference = T const&;
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+
+    chunked_vector () = default;
+    chunked_vector (chunked_vector&& o) noexcept
+        : chunks (std::move (o.chunks)), starts (std::move (o.starts))
+        , count (std::exchange (o.count, 0)), nodes (std::move (o.nodes)) {}
+    chunked_vector& operator= (chunked_vector&& o)
+    {
+        if (this != &o)
+        {
+            clear ();
+            chunks = std::move (o.chunks);
+            starts = std::move (o.starts);
+            count = std::exchange (o.count, 0);
+            nodes = std::move (o.nodes);
+            ++edits;
+        }
+        return *this;
+    }
+    ~chunked_vector () { clear (); }
+
+    std::size_t size () const { return count; }
+    bool empty () const { return !count; }
+    /// Changes on each insert, erase or replacement of the whole sequence
+    std::uint64_t version () const { return edits; }
+
+    T& operator[] (std::size_t i)
+    {
+        auto k = locate (i);
+        return *chunks[k][i - starts[k]];
+    }
+    T const& operator[] (std::size_t i) const
+    {
+        auto k = locate (i);
+        return *chunks[k][i - starts[k]];
+    }
+    T& front () { return *chunks.front ().front (); }
+    T& back () { return *chunks.back ().back (); }
+    T const& front () const { return *chunks.front ().front (); }
+    T const& back () const { return *chunks.back ().back (); }
+
+    iterator begin () { return { this, 0 }; }
+    iterator end () { return { this, count }; }
+    const_iterator begin () const { return { this, 0 }; }
+    const_iterator end () const { return { this, count }; }
+    const_iterator cbegin () const { return begin (); }
+    const_iterator cend () const { return end (); }
+
+    template<class... Args>
+    T& emplace (const_iterator pos, Args&&... args)
+    {
+        auto i = pos.i;
+        auto p = create (std::forward<Args> (args)...);
+        ++edits;
+        if (chunks.empty () || (i == count && chunks.back ().size () >= N))
+        {
+            chunks.emplace_back ().reserve (N);
+            starts.push_back (count);
+        }
+        auto k = locate (i);
+        auto& c = chunks[k];
+        c.insert (c.begin () + (i - starts[k]), p);
+        shift_starts (k, 1);
+        ++count;
+        if (c.size () > N)
+        {
+            std::vector<T*> half (c.begin () + c.size () / 2, c.end ());
+            half.reserve (N);
+            c.resize (c.size () / 2);
+            chunks.insert (chunks.begin () + k + 1, std::move (half));
+            starts.insert (starts.begin () + k + 1, starts[k] + chunks[k].size ());
+        }
+        return *p;
+    }
+
+    iterator insert (const_iterator pos, T const& v) { emplace (pos, v); return { this, pos.i }; }
+    iterator insert (const_iterator pos, T&& v) { emplace (pos, std::move (v)); return { this, pos.i }; }
+
+    template<class It>
+    iterator insert (const_iterator pos, It first, It last)
+    {
+        auto i = pos.i;
+        for (auto at = i; first != last; ++first)
+            emplace (const_iterator { this, at++ }, *first);
+        return { this, i };
+    }
+
+    template<class... Args>
+    T& emplace_back (Args&&... args) { return emplace (cend (), std::forward<Args> (args)...); }
+    void push_back (T const& v) { emplace (cend (), v); }
+    void push_back (T&& v) { emplace (cend (), std::move (v)); }
+
+    iterator erase (const_iterator first, const_iterator last)
+    {
+        auto i = first.i;
+        edits += first.i != last.i;
+        for (auto n = last.i - first.i; n; )
+        {
+            auto k = locate (i);
+            auto& c = chunks[k];
+            auto from = i - starts[k], to = std::min (c.size (), from + n);
+            std::for_each (c.begin () + from, c.begin () + to, [this] (T* p) { destroy (p); });
+            c.erase (c.begin () + from, c.begin () + to);
+            n -= to - from;
+            count -= to - from;
+            shift_starts (k, -std::ptrdiff_t (to - from));
+            if (c.empty ())
+            {
+                chunks.erase (chunks.begin () + k);
+                starts.erase (starts.begin () + k);
+            }
+        }
+        return { this, i };
+    }
+    iterator erase (const_iterator pos) { return erase (pos, pos + 1); }
+
+    void pop_back () { erase (cend () - 1); }
+
+    void resize (std::size_t n)
+    {
+        if (n < count)
+            erase (cbegin () + n, cend ());
+        while (count < n)
+            emplace_back ();
+    }
+
+    /// The pool keeps its memory for the next elements
+    void clear ()
+    {
+        for (auto& c: chunks)
+            for (auto p: c)
+                destroy (p);
+        edits += count != 0;
+        chunks.clear ();
+        starts.clear ();
+        count = 0;
+    }
+};
+
+//--------------------------------------------------------------------------------------------------
+
+#endif
+
@@ -0,0 +1,244 @@
+/**
+ * @file dds.cpp
+ * @internal
+ *
+ * This file is part of General Utilities project (aka Utils).
+ *
+ *   Utils is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Utils is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Utils If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Utilities
+ */
+
+#include <utils/dds.hpp>
+#include <utils/mapfile.hpp>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+
+//--------------------------------------------------------------------------------------------------
+
+namespace {
+
+constexpr std::uint32_t fourcc (char a, char b, char c, char d)
+{
+    return std::uint32_t (a) | std::uint32_t (b) << 8 | std::uint32_t (c) << 16
+        | std::uint32_t (d) << 24;
+}
+
+/// As in the file, little endian
+struct pixel_format_t
+{
+    std::uint32_t size, flags, fourcc, bits;
+    std::uint32_t masks[4];     ///< Red, green, blue & alpha
+};
+
+struct header_t
+{
+    std::uint32_t size, flags, height, width, pitch, depth, mips;
+    std::uint32_t reserved1[11];
+    pixel_format_t pf;
+    std::uint32_t caps, caps2, caps3, caps4, reserved2;
+};
+
+struct header_dx10_t
+{
+    std::uint32_t format, dimension, misc, array_size, misc2;
+};
+
+static_assert (sizeof (header_t) == 124 && sizeof (header_dx10_t) == 20);
+
+constexpr std::uint32_t magic = fourcc ('D', 'D', 'S', ' ');
+constexpr std::uint32_t flag_mips = 0x20000, flag_depth = 0x800000;
+constexpr std::uint32_t pf_alpha = 0x1, pf_fourcc = 0x4, pf_rgb = 0x40, pf_luminance = 0x20000;
+constexpr std::uint32_t caps2_cubemap = 0x200, caps2_volume = 0x200000;
+constexpr std::uint32_t dimension_2d = 3, misc_cube = 0x4;
+constexpr std::uint32_t max_size = 16384;   ///< Of the Direct3D 11 textures
+
+/// Bytes per 4x4 block of the compressed formats, or bits per pixel of the rest, zero if unknown
+struct format_size_t
+{
+    std::uint32_t format;
+    std::uint8_t block, bits;
+};
+
+constexpr format_size_t format_sizes[] = {
+    {  2, 0, 128 }, {  3, 0, 128 }, {  4, 0, 128 },                         // R32G32B32A32
+    { 10, 0,  64 }, { 11, 0,  64 }, { 12, 0,  64 }, { 13, 0,  64 }, { 14, 0, 64 },  // R16G16B16A16
+    { 24, 0,  32 }, { 25, 0,  32 }, { 26, 0,  32 },                         // R10G10B10A2, R11G11B10
+    { 28, 0,  32 }, { 29, 0,  32 }, { 30, 0,  32 }, { 31, 0,  32 }, { 32, 0, 32 },  // R8G8B8A8
+    { 34, 0,  32 }, { 35, 0,  32 }, { 41, 0,  32 },                         // R16G16, R32
+    { 49, 0,  16 }, { 54, 0,  16 }, { 56, 0,  16 },                         // R8G8, R16
+    { 61, 0,   8 }, { 65, 0,   8 },                                         // R8, A8
+    { 71, 8,   0 }, { 72, 8,   0 },                                         // BC1
+    { 74, 16,  0 }, { 75, 16,  0 }, { 77, 16, 0 }, { 78, 16, 0 },           // BC2, BC3
+    { 80, 8,   0 }, { 81, 8,   0 },                                         // BC4
+    { 83, 16,  0 }, { 84, 16,  0 },                                         // BC5
+    { 85, 0,  16 }, { 86, 0,  16 },                                         // B5G6R5, B5G5R5A1
+    { 87, 0,  32 }, { 88, 0,  32 }, { 91, 0,  32 }, { 93, 0,  32 },         // B8G8R8A8, B8G8R8X8
+    { 95, 16,  0 }, { 96, 16,  0 }, { 98, 16, 0 }, { 99, 16, 0 },           // BC6H, BC7
+    { 115, 0, 16 },                                                         // B4G4R4A4
+};
+
+format_size_t
+format_size (std::uint32_t format)
+{
+    for (auto const& f: format_sizes)
+        if (f.format == format)
+            return f;
+    return { format, 0, 0 };
+}
+
+/// The DXGI format of a legacy pixel format, zero if not covered
+std::uint32_t
+legacy_format (pixel_format_t const& pf)
+{
+    if (pf.flags & pf_fourcc)
+    {
+        switch (pf.fourcc)
+        {
+            case fourcc ('D', 'X', 'T', '1'): return 71;
+            case fourcc ('D', 'X', 'T', '2'):
+            case fourcc ('D', 'X', 'T', '3'): return 74;
+            case fourcc ('D', 'X', 'T', '4'):
+            case fourcc ('D', 'X', 'T', '5'): return 77;
+            case fourcc ('A', 'T', 'I', '1'):
+            case fourcc ('B', 'C', '4', 'U'): return 80;
+            case fourcc ('B', 'C', '4', 'S'): return 81;
+            case fourcc ('A', 'T', 'I', '2'):
+            case fourcc ('B', 'C', '5', 'U'): return 83;
+            case fourcc ('B', 'C', '5', 'S'): return 84;
+        }
+        return 0;
+    }
+
+    auto is = [&pf] (std::uint32_t bits, std::uint32_t r, std::uint32_t g, std::uint32_t b,
+                     std::uint32_t a) {
+        return pf.bits == bits && pf.masks[0] == r && pf.masks[1] == g && pf.masks[2] == b
+            && ((pf.flags & pf_alpha) ? pf.masks[3] : 0) == a;
+    };
+    if (pf.flags & pf_rgb)
+    {
+        if (is (32, 0xff, 0xff00, 0xff0000, 0xff000000)) return 28;
+        if (is (32, 0xff0000, 0xff00, 0xff, 0xff000000)) return 87;
+        if (is (32, 0xff0000, 0xff00, 0xff, 0)) return 88;
+        if (is (32, 0xffff, 0xffff0000, 0, 0)) return 35;
+        if (is (16, 0xf800, 0x7e0, 0x1f, 0)) return 85;
+        if (is (16, 0x7c00, 0x3e0, 0x1f, 0x8000)) return 86;
+        if (is (16, 0xf00, 0xf0, 0xf, 0xf000)) return 115;
+    }
+    else if ((pf.flags & pf_luminance) && is (8, 0xff, 0, 0, 0))
+        return 61;
+    else if ((pf.flags & pf_alpha) && pf.bits == 8 && pf.masks[3] == 0xff)
+        return 65;
+    return 0;
+}
+
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool
+parse_dds (std::string bytes, dds_t& dds)
+{
+    header_t h;
+    std::size_t offset = sizeof (magic) + sizeof (h);
+    if (bytes.size () < offset)
+        throw std::runtime_error ("Too short for a DDS file");
+    std::uint32_t m;
+    std::memcpy (&m, bytes.data (), sizeof (m));
+    std::memcpy (&h, bytes.data () + sizeof (m), sizeof (h));
+    if (m != magic || h.size != sizeof (h) || h.pf.size != sizeof (h.pf))
+        throw std::runtime_error ("Not a DDS file");
+    if (!h.width || !h.height || h.width > max_size || h.height > max_size)
+        throw std::runtime_error ("Bad DDS dimensions");
+
+    auto not_covered = [&] {
+        dds.levels.clear ();
+        dds.bytes = std::move (bytes);
+        return false;
+    };
+
+    std::uint32_t format;
+    if ((h.pf.flags & pf_fourcc) && h.pf.fourcc == fourcc ('D', 'X', '1', '0'))
+    {
+        header_dx10_t x;
+        if (bytes.size () < offset + sizeof (x))
+            throw std::runtime_error ("Truncated DDS DX10 header");
+        std::memcpy (&x, bytes.data () + offset, sizeof (x));
+        offset += sizeof (x);
+        if (x.dimension != dimension_2d || (x.misc & misc_cube) || x.array_size > 1)
+            return not_covered ();
+        format = x.format;
+    }
+    else
+    {
+        if ((h.caps2 & (caps2_cubemap | caps2_volume)) || ((h.flags & flag_depth) && h.depth > 1))
+            return not_covered ();
+        format = legacy_format (h.pf);
+    }
+
+    auto size = format_size (format);
+    if (!size.block && !size.bits)
+        return not_covered ();
+
+    std::uint32_t levels = (h.flags & flag_mips) ? std::max (h.mips, 1u) : 1;
+    std::uint32_t most = 1;
+    for (auto n = std::max (h.width, h.height); n > 1; n >>= 1)
+        ++most;
+    if (levels > most)
+        throw std::runtime_error ("Bad DDS mip levels count");
+
+    dds.levels.clear ();
+    for (std::uint32_t i = 0, w = h.width, h2 = h.height; i < levels; ++i)
+    {
+        dds_t::level_t l;
+        l.offset = offset;
+        if (size.block)
+        {
+            l.row_pitch = std::size_t (std::max (1u, (w + 3) / 4)) * size.block;
+            l.slice_pitch = l.row_pitch * std::max (1u, (h2 + 3) / 4);
+        }
+        else
+        {
+            l.row_pitch = (std::size_t (w) * size.bits + 7) / 8;
+            l.slice_pitch = l.row_pitch * h2;
+        }
+        offset += l.slice_pitch;
+        if (offset > bytes.size ())
+            throw std::runtime_error ("Truncated DDS image data");
+        dds.levels.push_back (l);
+        w = std::max (1u, w / 2);
+        h2 = std::max (1u, h2 / 2);
+    }
+
+    dds.width = h.width;
+    dds.height = h.height;
+    dds.format = format;
+    dds.bytes = std::move (bytes);
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool
+read_dds (std::string const& path, dds_t& dds)
+{
+    mapped_file file (path);
+    return parse_dds (std::string (file.begin (), file.end ()), dds);
+}
+
+//--------------------------------------------------------------------------------------------------
+
@@ -0,0 +1,70 @@
+/**
+ * @file dds.hpp
+ * @internal
+ *
+ * This file is part of General Utilities project (aka Utils).
+ *
+ *   Utils is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Utils is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Utils If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Utilities
+ *
+ * @details
+ * Reading and validation of DirectDraw Surface files, without any graphics API, so that it can be
+ * done away from the render thread (and on any platform). The result is laid out as the initial
+ * data of a Direct3D 11 texture: a DXGI format and the pitches of each mip level in the file.
+ *
+ * Covered are the single 2D textures (with or without mip levels) in the block compressed and the
+ * common uncompressed formats, be it through the legacy pixel format or the DX10 header. Cube
+ * maps, volumes, arrays and the rarer legacy formats are reported as not covered.
+ */
+
+#ifndef DDS_HPP
+#define DDS_HPP
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+//--------------------------------------------------------------------------------------------------
+
+struct dds_t
+{
+    std::uint32_t width, height;
+    std::uint32_t format;   ///< DXGI_FORMAT value
+
+    struct level_t
+    {
+        std::size_t offset;         ///< In #bytes
+        std::size_t row_pitch;      ///< Bytes per row of pixels, or of 4x4 blocks
+        std::size_t slice_pitch;
+    };
+    std::vector<level_t> levels;    ///< The largest mip level first
+
+    std::string bytes;              ///< The whole file
+};
+
+/// Takes over the file contents, throws std::runtime_error if malformed. A valid but not covered
+/// layout gives false, with the contents kept in dds_t::bytes but no levels.
+bool parse_dds (std::string bytes, dds_t& dds);
+
+/// Reads the file and then as parse_dds ()
+bool read_dds (std::string const& path, dds_t& dds);
+
+//--------------------------------------------------------------------------------------------------
+
+#endif
+
@@ -0,0 +1,240 @@
+/**
+ * @file jsonbook.hpp
+ * @internal
+ *
+ * This file is part of General Utilities project (aka Utils).
+ *
+ *   Utils is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Utils is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Utils If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Utilities
+ *
+ * @details
+ * The SAX loading of the JSON, CBOR and MessagePack books. It is on the page type, so that the
+ * benchmarks load the books with the same code as the game does.
+ *
+ * The page type is constructed from the memory resource of its texts and has the title, content
+ * and image (background, tint, uv and xy) of the journal pages.
+ */
+
+#ifndef JSONBOOK_HPP
+#define JSONBOOK_HPP
+
+#include <utils/mapfile.hpp>
+#include <nlohmann/json.hpp>
+#include <memory_resource>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Builds the book pages straight out of the parser events.
+ *
+ * The old way was to parse the whole file into a nlohmann::json DOM, then copy the strings into
+ * a temporary page map and then again into the journal. For the big books that is three copies
+ * of the whole text living at once. Here the parser string buffers are moved directly into the
+ * pages, so the text exists once (plus the parser buffer of the string in flight).
+ *
+ * Keys are tracked through a small stack of the currently open objects and arrays. Anything
+ * unknown is silently skipped, same as before with the DOM lookups, but the pages and each page
+ * must be objects, else the parse is stopped.
+ */
+
+template<class Page>
+class json_book_sax : public nlohmann::json_sax<nlohmann::json>
+{
+    struct frame_t
+    {
+        string_t key;   ///< Last seen key, if this frame is an object
+        int item;       ///< Count of array items seen so far, if this frame is an array
+    };
+    std::vector<frame_t> stack;
+
+    /// The currently open path, e.g. ("pages", "12", "image") is depth 3 with key "image"
+    bool at (std::size_t depth, const char* key) const
+    {
+        return stack.size () == depth && stack.back ().key == key;
+    }
+
+    bool in_page () const
+    {
+        return stack.size () >= 3 && stack[0].key == "pages" && !pages.empty ();
+    }
+
+    /// Only whole numbers in the range of @p T are taken
+    template<class T>
+    static bool whole (double v, T& out)
+    {
+        if (!(v >= 0 && v <= double (std::numeric_limits<T>::max ()) && v == std::floor (v)))
+            return false;
+        out = T (v);
+        return true;
+    }
+
+    bool number (double v)
+    {
+        if (at (1, "current"))
+        {
+            // Past any page, so that the loader falls back to the first one
+            if (!whole (v, current))
+                current = std::numeric_limits<unsigned>::max ();
+        }
+        else if (stack.size () == 2 && stack[0].key == "version" && stack[1].key == "major")
+            whole (v, major);
+        else if (in_page () && stack.size () == 5 && stack[2].key == "image")
+        {
+            auto& item = stack.back ().item;
+            auto& img = pages.back ().page.image;
+            if (stack[3].key == "uv" && unsigned (item) < img.uv.size ()) img.uv[item] = float (v);
+            if (stack[3].key == "xy" && unsigned (item) < img.xy.size ()) img.xy[item] = float (v);
+        }
+        return advance ();
+    }
+
+    /// Arrays count their items, so that the uv/xy coordinates can be put in place
+    bool advance ()
+    {
+        if (!stack.empty ())
+            ++stack.back ().item;
+        return true;
+    }
+
+public:
+    struct parsed_page_t
+    {
+        int ndx;
+        Page page;
+        bool has_image;
+        std::string image_file;
+    };
+
+    int major = -1;
+    unsigned current = 0;
+    std::vector<parsed_page_t> pages;
+    std::pmr::memory_resource* texts;   ///< Where the page texts go
+
+    explicit json_book_sax (std::pmr::memory_resource* texts) : texts (texts) {}
+
+    bool null () override { return advance (); }
+    bool boolean (bool v) override
+    {
+        if (in_page () && stack.size () == 4 && stack[2].key == "image"
+                && stack[3].key == "background")
+            pages.back ().page.image.background = v;
+        return advance ();
+    }
+    bool number_integer (number_integer_t v) override { return number (double (v)); }
+    bool number_unsigned (number_unsigned_t v) override { return number (double (v)); }
+    bool number_float (number_float_t v, string_t const&) override { return number (v); }
+    bool binary (binary_t&) override { return advance (); }
+
+    bool string (string_t& v) override
+    {
+        if (in_page ())
+        {
+            auto& p = pages.back ();
+            // Copied, not moved: the texts go to the book store, and the parser keeps reusing
+            // its grown buffer instead of growing a new one for each string
+            if (stack.size () == 3)
+            {
+                if (stack[2].key == "title") p.page.title = v;
+                else if (stack[2].key == "content") p.page.content = v;
+            }
+            else if (stack.size () == 4 && stack[2].key == "image")
+            {
+                if (stack[3].key == "file") p.image_file = v;
+                else if (stack[3].key == "tint") p.page.image.tint = std::stoull (v, nullptr, 0);
+            }
+        }
+        return advance ();
+    }
+
+    bool start_object (std::size_t) override
+    {
+        advance ();
+        if (stack.size () == 2 && stack[0].key == "pages")
+            pages.push_back ({ std::stoi (stack[1].key), Page (texts), false, {} });
+        else if (in_page () && at (3, "image"))
+            pages.back ().has_image = true;
+        stack.push_back ({});
+        return true;
+    }
+
+    bool key (string_t& v) override
+    {
+        stack.back ().key = v; // Short, while swapping would take the parser buffer
+        return true;
+    }
+
+    bool end_object () override
+    {
+        stack.pop_back ();
+        return true;
+    }
+
+    bool start_array (std::size_t) override
+    {
+        if (!stack.empty () && stack[0].key == "pages" && stack.size () <= 2)
+            return false;
+        advance ();
+        stack.push_back ({});
+        return true;
+    }
+
+    bool end_array () override
+    {
+        stack.pop_back ();
+        return true;
+    }
+
+    bool parse_error (std::size_t, std::string const&,
+            nlohmann::detail::exception const& ex) override
+    {
+        throw ex;
+    }
+};
+
+//--------------------------------------------------------------------------------------------------
+
+/// The pages end up in the book order, false if the book is not of the @p major version, throws if
+/// malformed
+template<class Page>
+bool
+parse_json_book (mapped_file const& file, nlohmann::detail::input_format_t format, int major,
+        json_book_sax<Page>& sax)
+{
+    if (!nlohmann::json::sax_parse (file.begin (), file.end (), &sax, format))
+        throw std::runtime_error ("Book pages are not objects");
+    if (sax.major != major)
+        return false;
+
+    // Sorting and gaps fixing, the first of any duplicated page numbers wins
+    auto& pages = sax.pages;
+    std::stable_sort (pages.begin (), pages.end (),
+            [] (auto const& a, auto const& b) { return a.ndx < b.ndx; });
+    pages.erase (std::unique (pages.begin (), pages.end (),
+            [] (auto const& a, auto const& b) { return a.ndx == b.ndx; }), pages.end ());
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+#endif
+
@@ -0,0 +1,205 @@
+/**
+ * @file jsonwriter.hpp
+ * @internal
+ *
+ * This file is part of General Utilities project (aka Utils).
+ *
+ *   Utils is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Utils is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Utils If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Utilities
+ */
+
+#ifndef JSONWRITER_HPP
+#define JSONWRITER_HPP
+
+#include <utils/utf8.hpp>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <type_traits>
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Emits JSON straight into a stream through a large buffer, no DOM or dumped string in between.
+ *
+ * Strings are escaped while copied into the buffer, so the memory needed stays about the buffer
+ * size regardless of the book size. The pretty mode indents like nlohmann::json::dump (4) does,
+ * except that number arrays are kept on one line.
+ *
+ * As with the error_handler_t::replace of dump (), invalid UTF-8 is written as U+FFFD and the not
+ * finite numbers as null. Else the book would be saved fine, but fail to parse on the next load.
+ */
+
+class json_writer
+{
+    std::ostream& os;
+    std::string buffer;
+    bool pretty;
+    int depth = 0;
+    bool first = true;      ///< No member written yet in the current object or array
+
+    static constexpr std::size_t capacity = 1 << 20;
+
+    void flush_full ()
+    {
+        if (buffer.size () >= capacity)
+            flush ();
+    }
+
+    void indent ()
+    {
+        if (pretty)
+        {
+            buffer += '\n';
+            buffer.append (std::size_t (depth) * 4, ' ');
+        }
+    }
+
+    void next ()
+    {
+        if (!first) buffer += ',';
+        first = false;
+        indent ();
+    }
+
+    void quoted (std::string_view s)
+    {
+        buffer += '"';
+        std::size_t run = 0;
+        for (std::size_t i = 0; i < s.size (); )
+        {
+            auto c = static_cast<unsigned char> (s[i]);
+            if (c >= 0x80)
+            {
+                char32_t cp;
+                auto n = utf8_decode (s, i, cp);
+                if (n == 1)
+                {
+                    buffer.append (s, run, i - run);
+                    utf8_append (buffer, cp);
+                    run = i + 1;
+                }
+                i += n;
+                continue;
+            }
+            if (c >= 0x20 && c != '"' && c != '\\')
+            {
+                ++i;
+                continue;
+            }
+            buffer.append (s, run, i - run);
+            run = ++i;
+            switch (c)
+            {
+                case '"':  buffer += "\\\""; break;
+                case '\\': buffer += "\\\\"; break;
+                case '\b': buffer += "\\b"; break;
+                case '\f': buffer += "\\f"; break;
+                case '\n': buffer += "\\n"; break;
+                case '\r': buffer += "\\r"; break;
+                case '\t': buffer += "\\t"; break;
+                default:
+                    constexpr char lut[] = "0123456789abcdef";
+                    buffer += "\\u00";
+                    buffer += lut[c >> 4];
+                    buffer += lut[c & 0xf];
+            }
+        }
+        buffer.append (s, run);
+        buffer += '"';
+        flush_full ();
+    }
+
+    template<class T>
+    void number (T v)
+    {
+        if constexpr (std::is_floating_point_v<T>)
+            if (!std::isfinite (v))
+            {
+                buffer += "null";
+                return;
+            }
+        std::array<char, 32> digits;
+        auto [end, ec] = std::to_chars (digits.data (), digits.data () + digits.size (), v);
+        buffer.append (digits.data (), end);
+    }
+
+public:
+    json_writer (std::ostream& os, bool pretty) : os (os), pretty (pretty)
+    {
+        buffer.reserve (capacity + capacity / 4);
+    }
+
+    void flush ()
+    {
+        os.write (buffer.data (), buffer.size ());
+        buffer.clear ();
+    }
+
+    void begin_object (std::string_view name = {})
+    {
+        if (!name.empty ()) key (name);
+        buffer += '{';
+        ++depth;
+        first = true;
+    }
+
+    void end_object ()
+    {
+        --depth;
+        if (!first) indent ();
+        buffer += '}';
+        first = false;
+        flush_full ();
+    }
+
+    void key (std::string_view name)
+    {
+        next ();
+        quoted (name);
+        buffer += pretty ? ": " : ":";
+    }
+
+    void member (std::string_view name, std::string_view v) { key (name); quoted (v); }
+    void member (std::string_view name, std::string const& v) { key (name); quoted (v); }
+    void member (std::string_view name, const char* v) { key (name); quoted (v); }
+    void member (std::string_view name, bool v) { key (name); buffer += v ? "true" : "false"; }
+
+    template<class T>
+    void member (std::string_view name, T v) { key (name); number (v); }
+
+    template<class T, std::size_t N>
+    void member (std::string_view name, std::array<T, N> const& v)
+    {
+        key (name);
+        buffer += '[';
+        for (std::size_t i = 0; i < N; ++i)
+        {
+            if (i) buffer += pretty ? ", " : ",";
+            number (v[i]);
+        }
+        buffer += ']';
+    }
+};
+
+//--------------------------------------------------------------------------------------------------
+
+#endif
+
@@ -0,0 +1,177 @@
+/**
+ * @file lz.cpp
+ * @internal
+ *
+ * This file is part of General Utilities project (aka Utils).
+ *
+ *   Utils is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Utils is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Utils If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Utilities
+ */
+
+#include <utils/lz.hpp>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+
+//--------------------------------------------------------------------------------------------------
+
+namespace {
+
+constexpr std::size_t min_match = 4;
+constexpr std::size_t max_offset = 0xffff;
+constexpr unsigned hash_bits = 14;
+
+/// The last bytes are always literals, so that matches never run up to the end
+constexpr std::size_t tail_literals = 5;
+
+inline std::uint32_t
+load32 (const char* p)
+{
+    std::uint32_t v;
+    std::memcpy (&v, p, sizeof (v));
+    return v;
+}
+
+inline unsigned
+hash32 (std::uint32_t v)
+{
+    return (v * 2654435761u) >> (32 - hash_bits);
+}
+
+inline void
+put_length (std::string& dst, std::size_t n)
+{
+    for (; n >= 255; n -= 255)
+        dst += char (255);
+    dst += char (n);
+}
+
+void
+put_sequence (std::string& dst, const char* literals, std::size_t count,
+              std::size_t offset, std::size_t match)
+{
+    auto lit = count < 15 ? count : 15;
+    auto len = match ? (match - min_match < 15 ? match - min_match : 15) : 0;
+    dst += char ((lit << 4) | len);
+    if (lit == 15) put_length (dst, count - 15);
+    dst.append (literals, count);
+    if (!match)
+        return;
+    dst += char (offset & 0xff);
+    dst += char (offset >> 8);
+    if (len == 15) put_length (dst, match - min_match - 15);
+}
+
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void
+lz_compress (const char* src, std::size_t n, std::string& dst)
+{
+    dst.reserve (dst.size () + n / 2 + 16);
+
+    std::size_t anchor = 0;
+    if (n > tail_literals + min_match)
+    {
+        std::vector<std::uint32_t> table (std::size_t (1) << hash_bits, 0);
+        std::size_t limit = n - tail_literals - min_match;
+        std::size_t i = 1; // Zero in the table means empty, hence start at one and skip the first
+        while (i <= limit)
+        {
+            auto v = load32 (src + i);
+            auto& slot = table[hash32 (v)];
+            std::size_t candidate = slot;
+            slot = std::uint32_t (i);
+
+            if (!candidate || i - candidate > max_offset || load32 (src + candidate) != v)
+            {
+                i += 1 + ((i - anchor) >> 6); // Skip faster over incompressible data
+                continue;
+            }
+
+            std::size_t match = min_match, end = n - tail_literals;
+            while (i + match < end && src[candidate + match] == src[i + match])
+                ++match;
+            while (i > anchor && candidate > 0 && src[i - 1] == src[candidate - 1])
+                --i, --candidate, ++match;
+
+            put_sequence (dst, src + anchor, i - anchor, i - candidate, match);
+            i += match;
+            anchor = i;
+            if (i - 2 <= limit)
+                table[hash32 (load32 (src + i - 2))] = std::uint32_t (i - 2);
+        }
+    }
+    put_sequence (dst, src + anchor, n - anchor, 0, 0);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool
+lz_decompress (const char* src, std::size_t size, char* dst, std::size_t n)
+{
+    auto in = reinterpret_cast<const unsigned char*> (src), in_end = in + size;
+    std::size_t out = 0;
+
+    auto get_length = [&] (std::size_t& v) {
+        unsigned char b;
+        do {
+            if (in == in_end) return false;
+            v += b = *in++;
+        } while (b == 255);
+        return true;
+    };
+
+    while (in < in_end)
+    {
+        unsigned token = *in++;
+        std::size_t count = token >> 4;
+        if (count == 15 && !get_length (count))
+            return false;
+        if (count > std::size_t (in_end - in) || count > n - out)
+            return false;
+        std::memcpy (dst + out, in, count);
+        in += count;
+        out += count;
+
+        if (in == in_end)
+            break; // The last sequence
+
+        if (in_end - in < 2)
+            return false;
+        std::size_t offset = in[0] | (in[1] << 8);
+        in += 2;
+        std::size_t match = token & 15;
+        if (match == 15 && !get_length (match))
+            return false;
+        match += min_match;
+        if (!offset || offset > out || match > n - out)
+            return false;
+
+        auto from = dst + out - offset;
+        if (offset >= match)
+            std::memcpy (dst + out, from, match);
+        else for (std::size_t k = 0; k < match; ++k) // Overlapping, i.e. repeating pattern
+            dst[out + k] = from[k];
+        out += match;
+    }
+    return out == n;
+}
+
+//--------------------------------------------------------------------------------------------------
+
@@ -0,0 +1,51 @@
+/**
+ * @file lz.hpp
+ * @internal
+ *
+ * This file is part of General Utilities project (aka Utils).
+ *
+ *   Utils is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Utils is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Utils If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Utilities
+ *
+ * @details
+ * Small and fast LZ77 block codec, in the spirit of LZ4. Each block is self-contained: it carries
+ * no window from the previous blocks and its decompressed size is to be stored by the caller.
+ *
+ * A block is a sequence of tokens. The high nibble of a token is the literals count, the low one
+ * is the match length minus 4. A nibble of 15 continues in the next bytes, each adding up to 255
+ * while it is 255. The literals follow, then the little endian 16 bit match offset. The very last
+ * sequence has only literals.
+ */
+
+#ifndef LZ_HPP
+#define LZ_HPP
+
+#include <string>
+#include <cstddef>
+
+//--------------------------------------------------------------------------------------------------
+
+/// Appends to @p dst the compressed form of the @p n bytes at @p src
+void lz_compress (const char* src, std::size_t n, std::string& dst);
+
+/// Decompresses exactly @p n bytes into @p dst, false if the block is malformed
+bool lz_decompress (const char* src, std::size_t size, char* dst, std::size_t n);
+
+//--------------------------------------------------------------------------------------------------
+
+#endif
+
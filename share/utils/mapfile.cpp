@@ -0,0 +1,151 @@
+/**
+ * @file mapfile.cpp
+ * @internal
+ *
+ * This file is part of General Utilities project (aka Utils).
+ *
+ *   Utils is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Utils is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Utils If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Utilities
+ */
+
+#include <utils/mapfile.hpp>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <utils/winutils.hpp>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+//--------------------------------------------------------------------------------------------------
+
+#ifdef _WIN32
+
+mapped_file::mapped_file (std::string const& path)
+{
+    std::wstring w;
+    if (!utf8_to_utf16 (path.c_str (), w))
+        throw std::runtime_error ("Unable to convert " + path + " to UTF-16");
+
+    HANDLE file = ::CreateFileW (w.c_str (), GENERIC_READ, FILE_SHARE_READ, nullptr,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        throw std::runtime_error ("Unable to open " + path + ": "
+                + format_utf8message (::GetLastError ()));
+
+    LARGE_INTEGER sz;
+    if (!::GetFileSizeEx (file, &sz))
+    {
+        auto error = ::GetLastError ();
+        ::CloseHandle (file);
+        throw std::runtime_error ("Unable to size " + path + ": " + format_utf8message (error));
+    }
+    length = std::size_t (sz.QuadPart);
+
+    SYSTEM_INFO si;
+    ::GetSystemInfo (&si);
+    granularity = si.dwPageSize;
+
+    if (!length) // Empty files can't be mapped, but they are still valid
+    {
+        ::CloseHandle (file);
+        return;
+    }
+
+    handle = ::CreateFileMappingW (file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+    auto error = ::GetLastError ();
+    ::CloseHandle (file); // The mapping keeps its own reference
+    if (!handle)
+        throw std::runtime_error ("Unable to map " + path + ": " + format_utf8message (error));
+
+    bytes = static_cast<char*> (::MapViewOfFile (handle, FILE_MAP_COPY, 0, 0, 0));
+    if (!bytes)
+    {
+        error = ::GetLastError ();
+        ::CloseHandle (handle);
+        throw std::runtime_error ("Unable to view " + path + ": " + format_utf8message (error));
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+mapped_file::~mapped_file ()
+{
+    if (bytes)
+        ::UnmapViewOfFile (bytes);
+    if (handle)
+        ::CloseHandle (handle);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+#else // POSIX
+
+static std::string
+error_text (int error)
+{
+    return std::strerror (error);
+}
+
+mapped_file::mapped_file (std::string const& path)
+{
+    int fd = ::open (path.c_str (), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw std::runtime_error ("Unable to open " + path + ": " + error_text (errno));
+
+    struct stat st;
+    if (::fstat (fd, &st) != 0)
+    {
+        auto error = errno;
+        ::close (fd);
+        throw std::runtime_error ("Unable to size " + path + ": " + error_text (error));
+    }
+    length = std::size_t (st.st_size);
+    granularity = std::size_t (::sysconf (_SC_PAGESIZE));
+
+    if (!length) // Empty files can't be mapped, but they are still valid
+    {
+        ::close (fd);
+        return;
+    }
+
+    void* view = ::mmap (nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    auto error = errno;
+    ::close (fd); // The mapping keeps its own reference
+    if (view == MAP_FAILED)
+        throw std::runtime_error ("Unable to map " + path + ": " + error_text (error));
+    ::madvise (view, length, MADV_SEQUENTIAL);
+    bytes = static_cast<char*> (view);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+mapped_file::~mapped_file ()
+{
+    if (bytes)
+        ::munmap (bytes, length);
+}
+
+#endif
+
+//--------------------------------------------------------------------------------------------------
+
@@ -0,0 +1,69 @@
+/**
+ * @file mapfile.hpp
+ * @internal
+ *
+ * This file is part of General Utilities project (aka Utils).
+ *
+ *   Utils is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Utils is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Utils If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Utilities
+ *
+ * @details
+ * Read only access to whole files through the OS memory mapping. Nothing is copied upfront, the
+ * pages are brought in while the contents are read. Implemented for Windows and POSIX systems.
+ */
+
+#ifndef MAPFILE_HPP
+#define MAPFILE_HPP
+
+#include <string>
+#include <cstddef>
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Maps a file in memory for its lifetime.
+ *
+ * The mapping is copy-on-write: the contents can be changed in place (e.g. by destructive
+ * parsers), but the changes never reach the file. Throws std::runtime_error on failure.
+ */
+
+class mapped_file
+{
+    char* bytes = nullptr;
+    std::size_t length = 0;
+    std::size_t granularity = 1;
+    void* handle = nullptr;     ///< The Windows file mapping object, unused on POSIX
+
+public:
+    explicit mapped_file (std::string const& path);
+    ~mapped_file ();
+    mapped_file (mapped_file const&) = delete;
+    mapped_file& operator= (mapped_file const&) = delete;
+
+    char* data () const { return bytes; }
+    std::size_t size () const { return length; }
+    char* begin () const { return bytes; }
+    char* end () const { return bytes + length; }
+
+    /// The OS fills with zeroes the last page past the file end, if there is such space
+    bool terminated () const { return length % granularity != 0; }
+};
+
+//--------------------------------------------------------------------------------------------------
+
+#endif
+
@@ -0,0 +1,283 @@
+/**
+ * @file search.cpp
+ * @internal
+ *
+ * This file is part of General Utilities project (aka Utils).
+ *
+ *   Utils is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Utils is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Utils If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Utilities
+ */
+
+#include <utils/search.hpp>
+#include <utils/utf8.hpp>
+#include <cstring>
+#include <cstdint>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define SEARCH_X86 1
+#include <immintrin.h>
+#endif
+
+//--------------------------------------------------------------------------------------------------
+
+namespace {
+
+constexpr auto npos = std::string_view::npos;
+
+inline char
+lower (char c)
+{
+    return c >= 'A' && c <= 'Z' ? char (c | 0x20) : c;
+}
+
+inline bool
+equal (const char* a, const char* b, std::size_t n, bool nocase)
+{
+    if (!nocase)
+        return !std::memcmp (a, b, n);
+    for (std::size_t i = 0; i < n; ++i)
+        if (lower (a[i]) != lower (b[i]))
+            return false;
+    return true;
+}
+
+/// From @p i on, for the rest of the text or the tail left by the vector loops
+std::size_t
+find_scalar (std::string_view text, std::string_view needle, std::size_t i, bool nocase)
+{
+    auto n = needle.size ();
+    auto first = nocase ? lower (needle.front ()) : needle.front ();
+    for (auto last = text.size () - n; i <= last; ++i)
+    {
+        auto c = nocase ? lower (text[i]) : text[i];
+        if (c == first && equal (text.data () + i + 1, needle.data () + 1, n - 1, nocase))
+            return i;
+    }
+    return npos;
+}
+
+#ifdef SEARCH_X86
+
+/// Sets bit 5 of the bytes in A-Z
+inline __m128i
+lower (__m128i x)
+{
+    // Signed compares only, so shift A-Z to the bottom of the signed range
+    auto shifted = _mm_add_epi8 (x, _mm_set1_epi8 (char (0x80 - 'A')));
+    auto upper = _mm_cmplt_epi8 (shifted, _mm_set1_epi8 (char (0x80 + 26)));
+    return _mm_or_si128 (x, _mm_and_si128 (upper, _mm_set1_epi8 (0x20)));
+}
+
+template<bool nocase>
+std::size_t
+find_sse2 (std::string_view text, std::string_view needle, std::size_t i)
+{
+    auto n = needle.size ();
+    auto first = _mm_set1_epi8 (nocase ? lower (needle.front ()) : needle.front ());
+    auto last = _mm_set1_epi8 (nocase ? lower (needle.back ()) : needle.back ());
+    auto p = text.data ();
+    for (; i + n - 1 + 16 <= text.size (); i += 16)
+    {
+        auto a = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (p + i));
+        auto b = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (p + i + n - 1));
+        if constexpr (nocase)
+            a = lower (a), b = lower (b);
+        unsigned mask = _mm_movemask_epi8 (
+                _mm_and_si128 (_mm_cmpeq_epi8 (a, first), _mm_cmpeq_epi8 (b, last)));
+        for (; mask; mask &= mask - 1)
+        {
+            auto k = i + __builtin_ctz (mask);
+            if (n <= 2 || equal (p + k + 1, needle.data () + 1, n - 2, nocase))
+                return k;
+        }
+    }
+    return find_scalar (text, needle, i, nocase);
+}
+
+/*
+ * No __m256i may cross a call: the 32 bytes aligned stack slots, for the arguments or the values
+ * kept over calls, are not aligned by GCC on the 64-bit Windows targets (GCC bug 54412). Hence the
+ * helpers are always inlined, and the vector scan is a leaf function with only scalars in and out.
+ */
+
+__attribute__ ((target ("avx2"), always_inline)) inline __m256i
+lower_avx2 (__m256i x)
+{
+    auto shifted = _mm256_add_epi8 (x, _mm256_set1_epi8 (char (0x80 - 'A')));
+    auto upper = _mm256_cmpgt_epi8 (_mm256_set1_epi8 (char (0x80 + 26)), shifted);
+    return _mm256_or_si256 (x, _mm256_and_si256 (upper, _mm256_set1_epi8 (0x20)));
+}
+
+/// Bit per position in the 32 bytes from @p p where both the first and the last byte match
+template<bool nocase>
+__attribute__ ((target ("avx2"), always_inline)) inline unsigned
+candidates_avx2 (const char* p, std::size_t n, __m256i first, __m256i last)
+{
+    auto a = _mm256_loadu_si256 (reinterpret_cast<const __m256i*> (p));
+    auto b = _mm256_loadu_si256 (reinterpret_cast<const __m256i*> (p + n - 1));
+    if constexpr (nocase)
+        a = lower_avx2 (a), b = lower_avx2 (b);
+    return _mm256_movemask_epi8 (
+            _mm256_and_si256 (_mm256_cmpeq_epi8 (a, first), _mm256_cmpeq_epi8 (b, last)));
+}
+
+/// The first 64 bytes block from @p i on with candidates in @p mask, or where the scan stopped
+template<bool nocase>
+__attribute__ ((target ("avx2"), noinline)) std::size_t
+scan_avx2 (std::string_view text, std::size_t n, char first, char last, std::size_t i,
+        std::uint64_t& mask)
+{
+    auto f = _mm256_set1_epi8 (first), l = _mm256_set1_epi8 (last);
+    auto p = text.data ();
+    // Two blocks at a time, as the candidates are rare in prose
+    for (; i + n - 1 + 64 <= text.size (); i += 64)
+    {
+        auto m0 = candidates_avx2<nocase> (p + i, n, f, l);
+        auto m1 = candidates_avx2<nocase> (p + i + 32, n, f, l);
+        if ((mask = m0 | std::uint64_t (m1) << 32))
+            return i;
+    }
+    mask = 0;
+    return i;
+}
+
+template<bool nocase>
+std::size_t
+find_avx2 (std::string_view text, std::string_view needle, std::size_t i)
+{
+    auto n = needle.size ();
+    auto first = nocase ? lower (needle.front ()) : needle.front ();
+    auto last = nocase ? lower (needle.back ()) : needle.back ();
+    auto p = text.data ();
+    for (std::uint64_t mask; (i = scan_avx2<nocase> (text, n, first, last, i, mask), mask);
+            i += 64)
+        for (; mask; mask &= mask - 1)
+        {
+            auto k = i + __builtin_ctzll (mask);
+            if (n <= 2 || equal (p + k + 1, needle.data () + 1, n - 2, nocase))
+                return k;
+        }
+    return find_sse2<nocase> (text, needle, i);
+}
+
+#endif
+
+std::size_t
+find (std::string_view text, std::string_view needle, std::size_t pos, bool nocase)
+{
+    if (pos > text.size () || needle.size () > text.size () - pos)
+        return npos;
+    if (needle.empty ())
+        return pos;
+#ifdef SEARCH_X86
+    static const bool avx2 = (__builtin_cpu_init (), __builtin_cpu_supports ("avx2"));
+    if (nocase)
+        return avx2 ? find_avx2<true> (text, needle, pos) : find_sse2<true> (text, needle, pos);
+    return avx2 ? find_avx2<false> (text, needle, pos) : find_sse2<false> (text, needle, pos);
+#else
+    return find_scalar (text, needle, pos, nocase);
+#endif
+}
+
+/// Letters past ASCII in valid UTF-8, else the bytes are to be matched as they are
+bool
+folds (std::string_view needle)
+{
+    auto i = ascii_prefix (needle);
+    if (i == needle.size ())
+        return false;
+    for (char32_t cp; i < needle.size (); )
+    {
+        auto n = utf8_decode (needle, i, cp);
+        if (n == 1 && (needle[i] & 0x80))
+            return false;
+        i += n;
+    }
+    return true;
+}
+
+/// True if the text from @p i on folds to the already folded @p needle
+bool
+folded_at (std::string_view text, std::size_t i, std::string_view needle)
+{
+    for (std::size_t k = 0; k < needle.size (); )
+    {
+        if (i == text.size ())
+            return false;
+        char32_t a, b;
+        i += utf8_decode_nfc (text, i, a);
+        k += utf8_decode (needle, k, b);
+        if (fold_case (a) != b)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * The needles with letters past ASCII. The candidates are found by the ASCII head of the needle,
+ * if any, with the vector search, else these are the non-ASCII code points of the text and the
+ * ASCII letters before them (which may compose with a mark).
+ */
+
+std::size_t
+find_folded (std::string_view text, std::string_view needle, std::size_t pos)
+{
+    auto folded = fold_utf8 (needle);
+    auto head = std::string_view (folded).substr (0, ascii_prefix (folded));
+    char32_t first, cp;
+    auto rest = std::string_view (folded).substr (utf8_decode (folded, 0, first));
+    for (auto i = pos; i < text.size (); )
+    {
+        if (!head.empty ())
+            i = find (text, head, i, true);
+        else if (!(text[i] & 0x80))
+        {
+            auto k = ascii_prefix (text, i);
+            i = k > i && k < text.size () ? k - 1 : k;
+        }
+        if (i >= text.size ())
+            return npos;
+        auto n = utf8_decode_nfc (text, i, cp);
+        if (fold_case (cp) == first && folded_at (text, i + n, rest))
+            return i;
+        i += head.empty () ? n : 1;
+    }
+    return npos;
+}
+
+}
+
+//--------------------------------------------------------------------------------------------------
+
+std::size_t
+find_text (std::string_view text, std::string_view needle, std::size_t pos)
+{
+    return find (text, needle, pos, false);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+std::size_t
+find_text_nocase (std::string_view text, std::string_view needle, std::size_t pos)
+{
+    if (folds (needle))
+        return find_folded (text, needle, pos);
+    return find (text, needle, pos, true);
+}
+
+//--------------------------------------------------------------------------------------------------
+
@@ -0,0 +1,52 @@
+/**
+ * @file search.hpp
+ * @internal
+ *
+ * This file is part of General Utilities project (aka Utils).
+ *
+ *   Utils is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Utils is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Utils If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Utilities
+ *
+ * @details
+ * Substring search for long texts. The first and the last byte of the needle are looked for at once
+ * in 16 (SSE2) or 32 (AVX2, if the CPU has it) bytes of the text, only the positions where both
+ * match are compared in full. Other CPUs get a plain loop of the same.
+ *
+ * The case insensitive search of ASCII needles folds the ASCII letters only, the rest of the bytes
+ * must match exactly, as for the needles not in valid UTF-8. The needles with other UTF-8 letters
+ * are compared code point by code point, composed and folded as of fold_utf8 (), only where the
+ * ASCII head of the needle is found (or anywhere past ASCII if none).
+ */
+
+#ifndef SEARCH_HPP
+#define SEARCH_HPP
+
+#include <string_view>
+#include <cstddef>
+
+//--------------------------------------------------------------------------------------------------
+
+/// As std::string_view::find (), npos if not found
+std::size_t find_text (std::string_view text, std::string_view needle, std::size_t pos = 0);
+
+/// As find_text (), with the letters of both compared in lower case
+std::size_t find_text_nocase (std::string_view text, std::string_view needle, std::size_t pos = 0);
+
+//--------------------------------------------------------------------------------------------------
+
+#endif
+
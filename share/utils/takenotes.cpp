@@ -0,0 +1,97 @@
+/**
+ * @file takenotes.cpp
+ * @internal
+ *
+ * This file is part of General Utilities project (aka Utils).
+ *
+ *   Utils is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Utils is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Utils If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Utilities
+ */
+
+#include <utils/takenotes.hpp>
+#include <algorithm>
+#include <charconv>
+#include <string_view>
+#include <stdexcept>
+
+//--------------------------------------------------------------------------------------------------
+
+namespace {
+
+/// The N of a /fiss/Data/dateN or /fiss/Data/entryN node, zero if not such
+std::size_t
+takenotes_index (rapidxml::xml_node<> const* node, std::string_view prefix)
+{
+    std::string_view name (node->name (), node->name_size ());
+    if (name.size () <= prefix.size () || name.compare (0, prefix.size (), prefix) != 0)
+        return 0;
+    std::size_t n = 0;
+    auto last = name.data () + name.size ();
+    auto [p, ec] = std::from_chars (name.data () + prefix.size (), last, n);
+    return ec == std::errc () && p == last ? n : 0;
+}
+
+}
+
+//--------------------------------------------------------------------------------------------------
+
+takenotes_nodes_t
+takenotes_pages (mapped_file& file, std::string& copy, rapidxml::xml_document<>& doc)
+{
+    char* text = file.data ();
+    if (!file.terminated ())
+    {
+        copy.assign (file.begin (), file.end ());
+        text = &copy[0];
+    }
+
+    doc.parse<0> (text);
+    auto fiss = doc.first_node ("fiss");
+    if (!fiss) throw std::runtime_error ("No /fiss node");
+    auto data = fiss->first_node ("Data");
+    if (!data) throw std::runtime_error ("No /fiss/Data node");
+    auto noe = data->first_node ("NumberOfEntries");
+    if (!noe) throw std::runtime_error ("No /fiss/Data/NumberOfEntries node");
+    std::string_view count (noe->value (), noe->value_size ());
+    count.remove_prefix (std::min (count.size (), count.find_first_not_of (" \t\r\n")));
+    std::size_t n = 0;
+    if (std::from_chars (count.data (), count.data () + count.size (), n).ec != std::errc ())
+        throw std::runtime_error ("Bad /fiss/Data/NumberOfEntries value");
+
+    // The count is not trusted with the allocation, there are no more pages than nodes
+    std::size_t children = 0;
+    for (auto node = data->first_node (); node; node = node->next_sibling ())
+        ++children;
+
+    // Bucketed by their N in a single pass, looking up each one by name is quadratic
+    takenotes_nodes_t nodes (std::min (n, children));
+    for (auto node = data->first_node (); node; node = node->next_sibling ())
+    {
+        if (auto i = takenotes_index (node, "date"); i && i <= nodes.size ())
+        {
+            if (!nodes[i-1].first) nodes[i-1].first = node;
+        }
+        else if (auto i = takenotes_index (node, "entry"); i && i <= nodes.size ())
+        {
+            if (!nodes[i-1].second) nodes[i-1].second = node;
+        }
+    }
+    return nodes;
+}
+
+//--------------------------------------------------------------------------------------------------
+
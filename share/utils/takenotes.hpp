@@ -0,0 +1,55 @@
+/**
+ * @file takenotes.hpp
+ * @internal
+ *
+ * This file is part of General Utilities project (aka Utils).
+ *
+ *   Utils is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Utils is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Utils If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Utilities
+ *
+ * @details
+ * The pages of the Take Notes mod journal, saved by it as FISS XML.
+ */
+
+#ifndef TAKENOTES_HPP
+#define TAKENOTES_HPP
+
+#include <utils/mapfile.hpp>
+#include <rapidxml/rapidxml.hpp>
+#include <string>
+#include <vector>
+#include <utility>
+
+//--------------------------------------------------------------------------------------------------
+
+using takenotes_nodes_t = std::vector<std::pair<rapidxml::xml_node<>*, rapidxml::xml_node<>*>>;
+
+/**
+ * The title (dateN) and the content (entryN) node of each page, null for the holes in the notes.
+ * As many as the NumberOfEntries says, but no more than the /fiss/Data nodes.
+ *
+ * RapidXML parses in place, which the copy-on-write mapping allows. It also needs a terminating
+ * zero, which only the mapping padding up to the page end provides, else the text goes to @p copy.
+ */
+
+takenotes_nodes_t takenotes_pages (mapped_file& file, std::string& copy,
+        rapidxml::xml_document<>& doc);
+
+//--------------------------------------------------------------------------------------------------
+
+#endif
+
@@ -0,0 +1,183 @@
+/**
+ * @file text.hpp
+ * @internal
+ *
+ * This file is part of General Utilities project (aka Utils).
+ *
+ *   Utils is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Utils is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Utils If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Utilities
+ *
+ * @details
+ * Editable text for the in-place edit widgets (like the ImGui ones). Such widgets write into a
+ * fixed, NUL terminated buffer and ask for a larger one only once it is full. The text keeps that
+ * buffer with its spare room apart from the length of the actual text, so neither growing nor
+ * reading it needs to scan for the terminator. The widget reports the new length on each edit.
+ */
+
+#ifndef TEXT_HPP
+#define TEXT_HPP
+
+#include <string>
+#include <string_view>
+#include <memory_resource>
+#include <algorithm>
+#include <cstring>
+#include <cstddef>
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * UTF-8 text with explicit length in a buffer which may be larger than the text.
+ *
+ * The byte after the text is always NUL, the bytes after it are undefined. Appending and the
+ * buffer growth are amortized over a geometric capacity, the rest of the edits move only the tail.
+ */
+
+class text_buffer
+{
+    std::pmr::string buf;   ///< The storage, its size is the buffer capacity plus the NUL
+    std::size_t len = 0;
+
+    /// Room for at least @p n bytes of text, the contents are kept
+    void grow (std::size_t n)
+    {
+        if (n < buf.size ())
+            return;
+        std::size_t cap = std::max<std::size_t> (16, buf.size ());
+        while (cap <= n) cap <<= 1;
+        buf.resize (cap);
+    }
+
+public:
+    using allocator_type = std::pmr::polymorphic_allocator<char>;
+    static constexpr std::size_t npos = std::string_view::npos;
+
+    text_buffer () = default;
+    explicit text_buffer (allocator_type a) : buf (a) {}
+    explicit text_buffer (std::string_view s, allocator_type a = {}) : buf (a) { assign (s); }
+    text_buffer (text_buffer const& t, allocator_type a = {}) : buf (a) { assign (t.view ()); }
+    text_buffer (text_buffer&& t) noexcept : buf (std::move (t.buf)), len (t.len) { t.len = 0; }
+
+    /// Copies only the text, the allocator and the spare room of the buffer are kept
+    text_buffer& operator= (text_buffer const& t) { return assign (t.view ()); }
+    text_buffer& operator= (text_buffer&& t)
+    {
+        if (buf.get_allocator () != t.buf.get_allocator ())
+            return assign (t.view ());
+        buf = std::move (t.buf);
+        len = t.len;
+        t.len = 0;
+        return *this;
+    }
+    text_buffer& operator= (std::string_view s) { return assign (s); }
+
+    allocator_type get_allocator () const { return buf.get_allocator (); }
+
+    std::size_t size () const { return len; }
+    bool empty () const { return !len; }
+    /// Bytes available for the text in #data() before growing, the NUL excluded
+    std::size_t capacity () const { return buf.empty () ? 0 : buf.size () - 1; }
+
+    const char* c_str () const { return buf.empty () ? "" : buf.data (); }
+    const char* data () const { return c_str (); }
+    /// The buffer to edit in place, it has room for #capacity() bytes plus the NUL
+    char* data () { grow (0); return buf.data (); }
+
+    std::string_view view () const { return { c_str (), len }; }
+    operator std::string_view () const { return view (); }
+
+    const char* begin () const { return c_str (); }
+    const char* end () const { return c_str () + len; }
+    char operator[] (std::size_t i) const { return buf[i]; }
+
+    std::size_t find (std::string_view s, std::size_t pos = 0) const { return view ().find (s, pos); }
+
+    void reserve (std::size_t n) { grow (n); }
+
+    /// New bytes are uninitialized, to be filled in through #data()
+    void resize (std::size_t n)
+    {
+        grow (n);
+        buf[len = n] = '\0';
+    }
+
+    void clear () { if (!buf.empty ()) buf[len = 0] = '\0'; }
+    /// Empty, with the buffer given back to the allocator
+    void release () { std::pmr::string (buf.get_allocator ()).swap (buf); len = 0; }
+
+    text_buffer& assign (const char* s, std::size_t n)
+    {
+        grow (n);
+        if (n)
+            std::memmove (buf.data (), s, n);
+        buf[len = n] = '\0';
+        return *this;
+    }
+    text_buffer& assign (std::string_view s) { return assign (s.data (), s.size ()); }
+
+    text_buffer& append (std::string_view s) { return replace (len, 0, s); }
+    text_buffer& insert (std::size_t pos, std::string_view s) { return replace (pos, 0, s); }
+    text_buffer& erase (std::size_t pos, std::size_t n = npos) { return replace (pos, n, {}); }
+
+    /// Clamps both @p pos and @p n to the text, @p s must not point in this text
+    text_buffer& replace (std::size_t pos, std::size_t n, std::string_view s)
+    {
+        pos = std::min (pos, len);
+        n = std::min (n, len - pos);
+        grow (len - n + s.size ());
+        auto p = buf.data () + pos;
+        std::memmove (p + s.size (), p + n, len - pos - n);
+        if (!s.empty ())
+            std::memcpy (p, s.data (), s.size ());
+        len = len - n + s.size ();
+        buf[len] = '\0';
+        return *this;
+    }
+
+    /// After an in-place edit through #data(), whose writer puts the NUL at @p n itself
+    void set_length (std::size_t n) { len = n; }
+
+    friend bool operator== (text_buffer const& a, std::string_view b) { return a.view () == b; }
+};
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Bulk storage for the texts of a loaded book, released in one go along with it.
+ *
+ * It is a pool over a monotonic arena, so that the edited pages can reuse the freed blocks. The
+ * pool is synchronized as the pages are also fetched from worker threads. Books with shelving
+ * enabled allocate each text on its own instead, as the arena would keep what shelving frees.
+ */
+
+struct text_store_t
+{
+    std::pmr::monotonic_buffer_resource arena;
+    std::pmr::synchronized_pool_resource pool;
+    std::pmr::memory_resource* resource;    ///< For the page texts
+
+    text_store_t (std::size_t initial, bool shelving)
+        : arena (shelving ? 1 << 10 : std::max<std::size_t> (initial, 1 << 16))
+        , pool (std::pmr::pool_options { 0, 1 << 16 }, &arena)
+        , resource (shelving ? std::pmr::new_delete_resource () : &pool)
+    {}
+};
+
+//--------------------------------------------------------------------------------------------------
+
+#endif
+
@@ -0,0 +1,541 @@
+/**
+ * @file utf8.cpp
+ * @internal
+ *
+ * This file is part of General Utilities project (aka Utils).
+ *
+ *   Utils is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Utils is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Utils If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Utilities
+ */
+
+#include <utils/utf8.hpp>
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <cstdint>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define UTF8_X86 1
+#include <immintrin.h>
+#endif
+
+//--------------------------------------------------------------------------------------------------
+
+namespace {
+
+/// Per lead byte, zero size if it can not lead, the second byte range rules out the overlong forms,
+/// the surrogates and these over U+10FFFF
+struct lead_t
+{
+    std::uint8_t size, bits, low, high;
+};
+
+constexpr std::array<lead_t, 256>
+make_leads ()
+{
+    std::array<lead_t, 256> t {};
+    for (unsigned c = 0; c < 0x80; ++c)
+        t[c] = { 1, 0x7f, 0, 0 };
+    for (unsigned c = 0xc2; c < 0xe0; ++c)
+        t[c] = { 2, 0x1f, 0x80, 0xbf };
+    for (unsigned c = 0xe0; c < 0xf0; ++c)
+        t[c] = { 3, 0x0f, 0x80, 0xbf };
+    for (unsigned c = 0xf0; c < 0xf5; ++c)
+        t[c] = { 4, 0x07, 0x80, 0xbf };
+    t[0xe0].low = 0xa0;
+    t[0xed].high = 0x9f;
+    t[0xf0].low = 0x90;
+    t[0xf4].high = 0x8f;
+    return t;
+}
+
+constexpr auto leads = make_leads ();
+
+/// Upper case letters from @p first to @p last, each @p stride, are @p delta from the lower case
+struct fold_range_t
+{
+    char32_t first, last;
+    int delta;
+    unsigned stride;
+};
+
+constexpr fold_range_t fold_ranges[] = {
+    // Basic Latin, Latin-1
+    { 0x41, 0x5a, 32, 1 }, { 0xb5, 0xb5, 0x3bc - 0xb5, 1 }, { 0xc0, 0xd6, 32, 1 },
+    { 0xd8, 0xde, 32, 1 },
+    // Latin Extended-A & B
+    { 0x100, 0x12e, 1, 2 }, { 0x132, 0x136, 1, 2 }, { 0x139, 0x147, 1, 2 }, { 0x14a, 0x176, 1, 2 },
+    { 0x178, 0x178, 0xff - 0x178, 1 }, { 0x179, 0x17d, 1, 2 }, { 0x17f, 0x17f, 's' - 0x17f, 1 },
+    { 0x1cd, 0x1db, 1, 2 }, { 0x1de, 0x1ee, 1, 2 }, { 0x1f8, 0x21e, 1, 2 }, { 0x222, 0x232, 1, 2 },
+    // Greek
+    { 0x386, 0x386, 38, 1 }, { 0x388, 0x38a, 37, 1 }, { 0x38c, 0x38c, 64, 1 },
+    { 0x38e, 0x38f, 63, 1 }, { 0x391, 0x3a1, 32, 1 }, { 0x3a3, 0x3ab, 32, 1 },
+    { 0x3c2, 0x3c2, 1, 1 }, { 0x3d8, 0x3ee, 1, 2 },
+    // Cyrillic
+    { 0x400, 0x40f, 80, 1 }, { 0x410, 0x42f, 32, 1 }, { 0x460, 0x480, 1, 2 }, { 0x48a, 0x4be, 1, 2 },
+    { 0x4c0, 0x4c0, 15, 1 }, { 0x4c1, 0x4cd, 1, 2 }, { 0x4d0, 0x52e, 1, 2 },
+    // Armenian
+    { 0x531, 0x556, 48, 1 },
+    // Latin Extended Additional
+    { 0x1e00, 0x1e94, 1, 2 }, { 0x1e9e, 0x1e9e, 0xdf - 0x1e9e, 1 }, { 0x1ea0, 0x1efe, 1, 2 },
+    // Fullwidth forms
+    { 0xff21, 0xff3a, 32, 1 },
+};
+
+/// Of the 256 code points blocks of the BMP, these with any upper case letter
+constexpr std::size_t
+count_fold_blocks ()
+{
+    bool used[256] = {};
+    std::size_t n = 1; // The zero block, for the rest
+    for (auto const& r: fold_ranges)
+        for (auto c = r.first; c <= r.last; c += r.stride)
+            if (!used[c >> 8])
+                used[c >> 8] = true, ++n;
+    return n;
+}
+
+/// Two stages, the block of the high byte, then the delta of the low one in it
+struct fold_tables_t
+{
+    std::array<std::uint8_t, 256> blocks;
+    std::array<std::array<std::int16_t, 256>, count_fold_blocks ()> deltas;
+};
+
+constexpr fold_tables_t
+make_fold_tables ()
+{
+    fold_tables_t t {};
+    std::uint8_t n = 1;
+    for (auto const& r: fold_ranges)
+        for (auto c = r.first; c <= r.last; c += r.stride)
+        {
+            auto& b = t.blocks[c >> 8];
+            if (!b)
+                b = n++;
+            t.deltas[b][c & 0xff] = std::int16_t (r.delta);
+        }
+    return t;
+}
+
+constexpr auto fold_tables = make_fold_tables ();
+
+static_assert (sizeof (fold_tables) < 8192);
+
+/// The base letter and the combining mark of a precomposed letter
+struct compose_t
+{
+    char16_t base, mark, composed;
+};
+
+/// The primary composites of U+00C0-024F, U+0400-04FF and U+1E00-1EFF (Unicode 14), as of the
+/// canonical decompositions in the UnicodeData.txt, sorted by base and mark
+constexpr compose_t compositions[] = {
+    { 0x41, 0x300, 0xc0 }, { 0x41, 0x301, 0xc1 }, { 0x41, 0x302, 0xc2 }, { 0x41, 0x303, 0xc3 },
+    { 0x41, 0x304, 0x100 }, { 0x41, 0x306, 0x102 }, { 0x41, 0x307, 0x226 }, { 0x41, 0x308, 0xc4 },
+    { 0x41, 0x309, 0x1ea2 }, { 0x41, 0x30a, 0xc5 }, { 0x41, 0x30c, 0x1cd }, { 0x41, 0x30f, 0x200 },
+    { 0x41, 0x311, 0x202 }, { 0x41, 0x323, 0x1ea0 }, { 0x41, 0x325, 0x1e00 },
+    { 0x41, 0x328, 0x104 }, { 0x42, 0x307, 0x1e02 }, { 0x42, 0x323, 0x1e04 },
+    { 0x42, 0x331, 0x1e06 }, { 0x43, 0x301, 0x106 }, { 0x43, 0x302, 0x108 }, { 0x43, 0x307, 0x10a },
+    { 0x43, 0x30c, 0x10c }, { 0x43, 0x327, 0xc7 }, { 0x44, 0x307, 0x1e0a }, { 0x44, 0x30c, 0x10e },
+    { 0x44, 0x323, 0x1e0c }, { 0x44, 0x327, 0x1e10 }, { 0x44, 0x32d, 0x1e12 },
+    { 0x44, 0x331, 0x1e0e }, { 0x45, 0x300, 0xc8 }, { 0x45, 0x301, 0xc9 }, { 0x45, 0x302, 0xca },
+    { 0x45, 0x303, 0x1ebc }, { 0x45, 0x304, 0x112 }, { 0x45, 0x306, 0x114 }, { 0x45, 0x307, 0x116 },
+    { 0x45, 0x308, 0xcb }, { 0x45, 0x309, 0x1eba }, { 0x45, 0x30c, 0x11a }, { 0x45, 0x30f, 0x204 },
+    { 0x45, 0x311, 0x206 }, { 0x45, 0x323, 0x1eb8 }, { 0x45, 0x327, 0x228 }, { 0x45, 0x328, 0x118 },
+    { 0x45, 0x32d, 0x1e18 }, { 0x45, 0x330, 0x1e1a }, { 0x46, 0x307, 0x1e1e },
+    { 0x47, 0x301, 0x1f4 }, { 0x47, 0x302, 0x11c }, { 0x47, 0x304, 0x1e20 }, { 0x47, 0x306, 0x11e },
+    { 0x47, 0x307, 0x120 }, { 0x47, 0x30c, 0x1e6 }, { 0x47, 0x327, 0x122 }, { 0x48, 0x302, 0x124 },
+    { 0x48, 0x307, 0x1e22 }, { 0x48, 0x308, 0x1e26 }, { 0x48, 0x30c, 0x21e },
+    { 0x48, 0x323, 0x1e24 }, { 0x48, 0x327, 0x1e28 }, { 0x48, 0x32e, 0x1e2a },
+    { 0x49, 0x300, 0xcc }, { 0x49, 0x301, 0xcd }, { 0x49, 0x302, 0xce }, { 0x49, 0x303, 0x128 },
+    { 0x49, 0x304, 0x12a }, { 0x49, 0x306, 0x12c }, { 0x49, 0x307, 0x130 }, { 0x49, 0x308, 0xcf },
+    { 0x49, 0x309, 0x1ec8 }, { 0x49, 0x30c, 0x1cf }, { 0x49, 0x30f, 0x208 }, { 0x49, 0x311, 0x20a },
+    { 0x49, 0x323, 0x1eca }, { 0x49, 0x328, 0x12e }, { 0x49, 0x330, 0x1e2c },
+    { 0x4a, 0x302, 0x134 }, { 0x4b, 0x301, 0x1e30 }, { 0x4b, 0x30c, 0x1e8 },
+    { 0x4b, 0x323, 0x1e32 }, { 0x4b, 0x327, 0x136 }, { 0x4b, 0x331, 0x1e34 },
+    { 0x4c, 0x301, 0x139 }, { 0x4c, 0x30c, 0x13d }, { 0x4c, 0x323, 0x1e36 }, { 0x4c, 0x327, 0x13b },
+    { 0x4c, 0x32d, 0x1e3c }, { 0x4c, 0x331, 0x1e3a }, { 0x4d, 0x301, 0x1e3e },
+    { 0x4d, 0x307, 0x1e40 }, { 0x4d, 0x323, 0x1e42 }, { 0x4e, 0x300, 0x1f8 },
+    { 0x4e, 0x301, 0x143 }, { 0x4e, 0x303, 0xd1 }, { 0x4e, 0x307, 0x1e44 }, { 0x4e, 0x30c, 0x147 },
+    { 0x4e, 0x323, 0x1e46 }, { 0x4e, 0x327, 0x145 }, { 0x4e, 0x32d, 0x1e4a },
+    { 0x4e, 0x331, 0x1e48 }, { 0x4f, 0x300, 0xd2 }, { 0x4f, 0x301, 0xd3 }, { 0x4f, 0x302, 0xd4 },
+    { 0x4f, 0x303, 0xd5 }, { 0x4f, 0x304, 0x14c }, { 0x4f, 0x306, 0x14e }, { 0x4f, 0x307, 0x22e },
+    { 0x4f, 0x308, 0xd6 }, { 0x4f, 0x309, 0x1ece }, { 0x4f, 0x30b, 0x150 }, { 0x4f, 0x30c, 0x1d1 },
+    { 0x4f, 0x30f, 0x20c }, { 0x4f, 0x311, 0x20e }, { 0x4f, 0x31b, 0x1a0 }, { 0x4f, 0x323, 0x1ecc },
+    { 0x4f, 0x328, 0x1ea }, { 0x50, 0x301, 0x1e54 }, { 0x50, 0x307, 0x1e56 },
+    { 0x52, 0x301, 0x154 }, { 0x52, 0x307, 0x1e58 }, { 0x52, 0x30c, 0x158 }, { 0x52, 0x30f, 0x210 },
+    { 0x52, 0x311, 0x212 }, { 0x52, 0x323, 0x1e5a }, { 0x52, 0x327, 0x156 },
+    { 0x52, 0x331, 0x1e5e }, { 0x53, 0x301, 0x15a }, { 0x53, 0x302, 0x15c },
+    { 0x53, 0x307, 0x1e60 }, { 0x53, 0x30c, 0x160 }, { 0x53, 0x323, 0x1e62 },
+    { 0x53, 0x326, 0x218 }, { 0x53, 0x327, 0x15e }, { 0x54, 0x307, 0x1e6a }, { 0x54, 0x30c, 0x164 },
+    { 0x54, 0x323, 0x1e6c }, { 0x54, 0x326, 0x21a }, { 0x54, 0x327, 0x162 },
+    { 0x54, 0x32d, 0x1e70 }, { 0x54, 0x331, 0x1e6e }, { 0x55, 0x300, 0xd9 }, { 0x55, 0x301, 0xda },
+    { 0x55, 0x302, 0xdb }, { 0x55, 0x303, 0x168 }, { 0x55, 0x304, 0x16a }, { 0x55, 0x306, 0x16c },
+    { 0x55, 0x308, 0xdc }, { 0x55, 0x309, 0x1ee6 }, { 0x55, 0x30a, 0x16e }, { 0x55, 0x30b, 0x170 },
+    { 0x55, 0x30c, 0x1d3 }, { 0x55, 0x30f, 0x214 }, { 0x55, 0x311, 0x216 }, { 0x55, 0x31b, 0x1af },
+    { 0x55, 0x323, 0x1ee4 }, { 0x55, 0x324, 0x1e72 }, { 0x55, 0x328, 0x172 },
+    { 0x55, 0x32d, 0x1e76 }, { 0x55, 0x330, 0x1e74 }, { 0x56, 0x303, 0x1e7c },
+    { 0x56, 0x323, 0x1e7e }, { 0x57, 0x300, 0x1e80 }, { 0x57, 0x301, 0x1e82 },
+    { 0x57, 0x302, 0x174 }, { 0x57, 0x307, 0x1e86 }, { 0x57, 0x308, 0x1e84 },
+    { 0x57, 0x323, 0x1e88 }, { 0x58, 0x307, 0x1e8a }, { 0x58, 0x308, 0x1e8c },
+    { 0x59, 0x300, 0x1ef2 }, { 0x59, 0x301, 0xdd }, { 0x59, 0x302, 0x176 }, { 0x59, 0x303, 0x1ef8 },
+    { 0x59, 0x304, 0x232 }, { 0x59, 0x307, 0x1e8e }, { 0x59, 0x308, 0x178 },
+    { 0x59, 0x309, 0x1ef6 }, { 0x59, 0x323, 0x1ef4 }, { 0x5a, 0x301, 0x179 },
+    { 0x5a, 0x302, 0x1e90 }, { 0x5a, 0x307, 0x17b }, { 0x5a, 0x30c, 0x17d },
+    { 0x5a, 0x323, 0x1e92 }, { 0x5a, 0x331, 0x1e94 }, { 0x61, 0x300, 0xe0 }, { 0x61, 0x301, 0xe1 },
+    { 0x61, 0x302, 0xe2 }, { 0x61, 0x303, 0xe3 }, { 0x61, 0x304, 0x101 }, { 0x61, 0x306, 0x103 },
+    { 0x61, 0x307, 0x227 }, { 0x61, 0x308, 0xe4 }, { 0x61, 0x309, 0x1ea3 }, { 0x61, 0x30a, 0xe5 },
+    { 0x61, 0x30c, 0x1ce }, { 0x61, 0x30f, 0x201 }, { 0x61, 0x311, 0x203 }, { 0x61, 0x323, 0x1ea1 },
+    { 0x61, 0x325, 0x1e01 }, { 0x61, 0x328, 0x105 }, { 0x62, 0x307, 0x1e03 },
+    { 0x62, 0x323, 0x1e05 }, { 0x62, 0x331, 0x1e07 }, { 0x63, 0x301, 0x107 },
+    { 0x63, 0x302, 0x109 }, { 0x63, 0x307, 0x10b }, { 0x63, 0x30c, 0x10d }, { 0x63, 0x327, 0xe7 },
+    { 0x64, 0x307, 0x1e0b }, { 0x64, 0x30c, 0x10f }, { 0x64, 0x323, 0x1e0d },
+    { 0x64, 0x327, 0x1e11 }, { 0x64, 0x32d, 0x1e13 }, { 0x64, 0x331, 0x1e0f },
+    { 0x65, 0x300, 0xe8 }, { 0x65, 0x301, 0xe9 }, { 0x65, 0x302, 0xea }, { 0x65, 0x303, 0x1ebd },
+    { 0x65, 0x304, 0x113 }, { 0x65, 0x306, 0x115 }, { 0x65, 0x307, 0x117 }, { 0x65, 0x308, 0xeb },
+    { 0x65, 0x309, 0x1ebb }, { 0x65, 0x30c, 0x11b }, { 0x65, 0x30f, 0x205 }, { 0x65, 0x311, 0x207 },
+    { 0x65, 0x323, 0x1eb9 }, { 0x65, 0x327, 0x229 }, { 0x65, 0x328, 0x119 },
+    { 0x65, 0x32d, 0x1e19 }, { 0x65, 0x330, 0x1e1b }, { 0x66, 0x307, 0x1e1f },
+    { 0x67, 0x301, 0x1f5 }, { 0x67, 0x302, 0x11d }, { 0x67, 0x304, 0x1e21 }, { 0x67, 0x306, 0x11f },
+    { 0x67, 0x307, 0x121 }, { 0x67, 0x30c, 0x1e7 }, { 0x67, 0x327, 0x123 }, { 0x68, 0x302, 0x125 },
+    { 0x68, 0x307, 0x1e23 }, { 0x68, 0x308, 0x1e27 }, { 0x68, 0x30c, 0x21f },
+    { 0x68, 0x323, 0x1e25 }, { 0x68, 0x327, 0x1e29 }, { 0x68, 0x32e, 0x1e2b },
+    { 0x68, 0x331, 0x1e96 }, { 0x69, 0x300, 0xec }, { 0x69, 0x301, 0xed }, { 0x69, 0x302, 0xee },
+    { 0x69, 0x303, 0x129 }, { 0x69, 0x304, 0x12b }, { 0x69, 0x306, 0x12d }, { 0x69, 0x308, 0xef },
+    { 0x69, 0x309, 0x1ec9 }, { 0x69, 0x30c, 0x1d0 }, { 0x69, 0x30f, 0x209 }, { 0x69, 0x311, 0x20b },
+    { 0x69, 0x323, 0x1ecb }, { 0x69, 0x328, 0x12f }, { 0x69, 0x330, 0x1e2d },
+    { 0x6a, 0x302, 0x135 }, { 0x6a, 0x30c, 0x1f0 }, { 0x6b, 0x301, 0x1e31 }, { 0x6b, 0x30c, 0x1e9 },
+    { 0x6b, 0x323, 0x1e33 }, { 0x6b, 0x327, 0x137 }, { 0x6b, 0x331, 0x1e35 },
+    { 0x6c, 0x301, 0x13a }, { 0x6c, 0x30c, 0x13e }, { 0x6c, 0x323, 0x1e37 }, { 0x6c, 0x327, 0x13c },
+    { 0x6c, 0x32d, 0x1e3d }, { 0x6c, 0x331, 0x1e3b }, { 0x6d, 0x301, 0x1e3f },
+    { 0x6d, 0x307, 0x1e41 }, { 0x6d, 0x323, 0x1e43 }, { 0x6e, 0x300, 0x1f9 },
+    { 0x6e, 0x301, 0x144 }, { 0x6e, 0x303, 0xf1 }, { 0x6e, 0x307, 0x1e45 }, { 0x6e, 0x30c, 0x148 },
+    { 0x6e, 0x323, 0x1e47 }, { 0x6e, 0x327, 0x146 }, { 0x6e, 0x32d, 0x1e4b },
+    { 0x6e, 0x331, 0x1e49 }, { 0x6f, 0x300, 0xf2 }, { 0x6f, 0x301, 0xf3 }, { 0x6f, 0x302, 0xf4 },
+    { 0x6f, 0x303, 0xf5 }, { 0x6f, 0x304, 0x14d }, { 0x6f, 0x306, 0x14f }, { 0x6f, 0x307, 0x22f },
+    { 0x6f, 0x308, 0xf6 }, { 0x6f, 0x309, 0x1ecf }, { 0x6f, 0x30b, 0x151 }, { 0x6f, 0x30c, 0x1d2 },
+    { 0x6f, 0x30f, 0x20d }, { 0x6f, 0x311, 0x20f }, { 0x6f, 0x31b, 0x1a1 }, { 0x6f, 0x323, 0x1ecd },
+    { 0x6f, 0x328, 0x1eb }, { 0x70, 0x301, 0x1e55 }, { 0x70, 0x307, 0x1e57 },
+    { 0x72, 0x301, 0x155 }, { 0x72, 0x307, 0x1e59 }, { 0x72, 0x30c, 0x159 }, { 0x72, 0x30f, 0x211 },
+    { 0x72, 0x311, 0x213 }, { 0x72, 0x323, 0x1e5b }, { 0x72, 0x327, 0x157 },
+    { 0x72, 0x331, 0x1e5f }, { 0x73, 0x301, 0x15b }, { 0x73, 0x302, 0x15d },
+    { 0x73, 0x307, 0x1e61 }, { 0x73, 0x30c, 0x161 }, { 0x73, 0x323, 0x1e63 },
+    { 0x73, 0x326, 0x219 }, { 0x73, 0x327, 0x15f }, { 0x74, 0x307, 0x1e6b },
+    { 0x74, 0x308, 0x1e97 }, { 0x74, 0x30c, 0x165 }, { 0x74, 0x323, 0x1e6d },
+    { 0x74, 0x326, 0x21b }, { 0x74, 0x327, 0x163 }, { 0x74, 0x32d, 0x1e71 },
+    { 0x74, 0x331, 0x1e6f }, { 0x75, 0x300, 0xf9 }, { 0x75, 0x301, 0xfa }, { 0x75, 0x302, 0xfb },
+    { 0x75, 0x303, 0x169 }, { 0x75, 0x304, 0x16b }, { 0x75, 0x306, 0x16d }, { 0x75, 0x308, 0xfc },
+    { 0x75, 0x309, 0x1ee7 }, { 0x75, 0x30a, 0x16f }, { 0x75, 0x30b, 0x171 }, { 0x75, 0x30c, 0x1d4 },
+    { 0x75, 0x30f, 0x215 }, { 0x75, 0x311, 0x217 }, { 0x75, 0x31b, 0x1b0 }, { 0x75, 0x323, 0x1ee5 },
+    { 0x75, 0x324, 0x1e73 }, { 0x75, 0x328, 0x173 }, { 0x75, 0x32d, 0x1e77 },
+    { 0x75, 0x330, 0x1e75 }, { 0x76, 0x303, 0x1e7d }, { 0x76, 0x323, 0x1e7f },
+    { 0x77, 0x300, 0x1e81 }, { 0x77, 0x301, 0x1e83 }, { 0x77, 0x302, 0x175 },
+    { 0x77, 0x307, 0x1e87 }, { 0x77, 0x308, 0x1e85 }, { 0x77, 0x30a, 0x1e98 },
+    { 0x77, 0x323, 0x1e89 }, { 0x78, 0x307, 0x1e8b }, { 0x78, 0x308, 0x1e8d },
+    { 0x79, 0x300, 0x1ef3 }, { 0x79, 0x301, 0xfd }, { 0x79, 0x302, 0x177 }, { 0x79, 0x303, 0x1ef9 },
+    { 0x79, 0x304, 0x233 }, { 0x79, 0x307, 0x1e8f }, { 0x79, 0x308, 0xff }, { 0x79, 0x309, 0x1ef7 },
+    { 0x79, 0x30a, 0x1e99 }, { 0x79, 0x323, 0x1ef5 }, { 0x7a, 0x301, 0x17a },
+    { 0x7a, 0x302, 0x1e91 }, { 0x7a, 0x307, 0x17c }, { 0x7a, 0x30c, 0x17e },
+    { 0x7a, 0x323, 0x1e93 }, { 0x7a, 0x331, 0x1e95 }, { 0xc2, 0x300, 0x1ea6 },
+    { 0xc2, 0x301, 0x1ea4 }, { 0xc2, 0x303, 0x1eaa }, { 0xc2, 0x309, 0x1ea8 },
+    { 0xc4, 0x304, 0x1de }, { 0xc5, 0x301, 0x1fa }, { 0xc6, 0x301, 0x1fc }, { 0xc6, 0x304, 0x1e2 },
+    { 0xc7, 0x301, 0x1e08 }, { 0xca, 0x300, 0x1ec0 }, { 0xca, 0x301, 0x1ebe },
+    { 0xca, 0x303, 0x1ec4 }, { 0xca, 0x309, 0x1ec2 }, { 0xcf, 0x301, 0x1e2e },
+    { 0xd4, 0x300, 0x1ed2 }, { 0xd4, 0x301, 0x1ed0 }, { 0xd4, 0x303, 0x1ed6 },
+    { 0xd4, 0x309, 0x1ed4 }, { 0xd5, 0x301, 0x1e4c }, { 0xd5, 0x304, 0x22c },
+    { 0xd5, 0x308, 0x1e4e }, { 0xd6, 0x304, 0x22a }, { 0xd8, 0x301, 0x1fe }, { 0xdc, 0x300, 0x1db },
+    { 0xdc, 0x301, 0x1d7 }, { 0xdc, 0x304, 0x1d5 }, { 0xdc, 0x30c, 0x1d9 }, { 0xe2, 0x300, 0x1ea7 },
+    { 0xe2, 0x301, 0x1ea5 }, { 0xe2, 0x303, 0x1eab }, { 0xe2, 0x309, 0x1ea9 },
+    { 0xe4, 0x304, 0x1df }, { 0xe5, 0x301, 0x1fb }, { 0xe6, 0x301, 0x1fd }, { 0xe6, 0x304, 0x1e3 },
+    { 0xe7, 0x301, 0x1e09 }, { 0xea, 0x300, 0x1ec1 }, { 0xea, 0x301, 0x1ebf },
+    { 0xea, 0x303, 0x1ec5 }, { 0xea, 0x309, 0x1ec3 }, { 0xef, 0x301, 0x1e2f },
+    { 0xf4, 0x300, 0x1ed3 }, { 0xf4, 0x301, 0x1ed1 }, { 0xf4, 0x303, 0x1ed7 },
+    { 0xf4, 0x309, 0x1ed5 }, { 0xf5, 0x301, 0x1e4d }, { 0xf5, 0x304, 0x22d },
+    { 0xf5, 0x308, 0x1e4f }, { 0xf6, 0x304, 0x22b }, { 0xf8, 0x301, 0x1ff }, { 0xfc, 0x300, 0x1dc },
+    { 0xfc, 0x301, 0x1d8 }, { 0xfc, 0x304, 0x1d6 }, { 0xfc, 0x30c, 0x1da },
+    { 0x102, 0x300, 0x1eb0 }, { 0x102, 0x301, 0x1eae }, { 0x102, 0x303, 0x1eb4 },
+    { 0x102, 0x309, 0x1eb2 }, { 0x103, 0x300, 0x1eb1 }, { 0x103, 0x301, 0x1eaf },
+    { 0x103, 0x303, 0x1eb5 }, { 0x103, 0x309, 0x1eb3 }, { 0x112, 0x300, 0x1e14 },
+    { 0x112, 0x301, 0x1e16 }, { 0x113, 0x300, 0x1e15 }, { 0x113, 0x301, 0x1e17 },
+    { 0x14c, 0x300, 0x1e50 }, { 0x14c, 0x301, 0x1e52 }, { 0x14d, 0x300, 0x1e51 },
+    { 0x14d, 0x301, 0x1e53 }, { 0x15a, 0x307, 0x1e64 }, { 0x15b, 0x307, 0x1e65 },
+    { 0x160, 0x307, 0x1e66 }, { 0x161, 0x307, 0x1e67 }, { 0x168, 0x301, 0x1e78 },
+    { 0x169, 0x301, 0x1e79 }, { 0x16a, 0x308, 0x1e7a }, { 0x16b, 0x308, 0x1e7b },
+    { 0x17f, 0x307, 0x1e9b }, { 0x1a0, 0x300, 0x1edc }, { 0x1a0, 0x301, 0x1eda },
+    { 0x1a0, 0x303, 0x1ee0 }, { 0x1a0, 0x309, 0x1ede }, { 0x1a0, 0x323, 0x1ee2 },
+    { 0x1a1, 0x300, 0x1edd }, { 0x1a1, 0x301, 0x1edb }, { 0x1a1, 0x303, 0x1ee1 },
+    { 0x1a1, 0x309, 0x1edf }, { 0x1a1, 0x323, 0x1ee3 }, { 0x1af, 0x300, 0x1eea },
+    { 0x1af, 0x301, 0x1ee8 }, { 0x1af, 0x303, 0x1eee }, { 0x1af, 0x309, 0x1eec },
+    { 0x1af, 0x323, 0x1ef0 }, { 0x1b0, 0x300, 0x1eeb }, { 0x1b0, 0x301, 0x1ee9 },
+    { 0x1b0, 0x303, 0x1eef }, { 0x1b0, 0x309, 0x1eed }, { 0x1b0, 0x323, 0x1ef1 },
+    { 0x1b7, 0x30c, 0x1ee }, { 0x1ea, 0x304, 0x1ec }, { 0x1eb, 0x304, 0x1ed },
+    { 0x226, 0x304, 0x1e0 }, { 0x227, 0x304, 0x1e1 }, { 0x228, 0x306, 0x1e1c },
+    { 0x229, 0x306, 0x1e1d }, { 0x22e, 0x304, 0x230 }, { 0x22f, 0x304, 0x231 },
+    { 0x292, 0x30c, 0x1ef }, { 0x406, 0x308, 0x407 }, { 0x410, 0x306, 0x4d0 },
+    { 0x410, 0x308, 0x4d2 }, { 0x413, 0x301, 0x403 }, { 0x415, 0x300, 0x400 },
+    { 0x415, 0x306, 0x4d6 }, { 0x415, 0x308, 0x401 }, { 0x416, 0x306, 0x4c1 },
+    { 0x416, 0x308, 0x4dc }, { 0x417, 0x308, 0x4de }, { 0x418, 0x300, 0x40d },
+    { 0x418, 0x304, 0x4e2 }, { 0x418, 0x306, 0x419 }, { 0x418, 0x308, 0x4e4 },
+    { 0x41a, 0x301, 0x40c }, { 0x41e, 0x308, 0x4e6 }, { 0x423, 0x304, 0x4ee },
+    { 0x423, 0x306, 0x40e }, { 0x423, 0x308, 0x4f0 }, { 0x423, 0x30b, 0x4f2 },
+    { 0x427, 0x308, 0x4f4 }, { 0x42b, 0x308, 0x4f8 }, { 0x42d, 0x308, 0x4ec },
+    { 0x430, 0x306, 0x4d1 }, { 0x430, 0x308, 0x4d3 }, { 0x433, 0x301, 0x453 },
+    { 0x435, 0x300, 0x450 }, { 0x435, 0x306, 0x4d7 }, { 0x435, 0x308, 0x451 },
+    { 0x436, 0x306, 0x4c2 }, { 0x436, 0x308, 0x4dd }, { 0x437, 0x308, 0x4df },
+    { 0x438, 0x300, 0x45d }, { 0x438, 0x304, 0x4e3 }, { 0x438, 0x306, 0x439 },
+    { 0x438, 0x308, 0x4e5 }, { 0x43a, 0x301, 0x45c }, { 0x43e, 0x308, 0x4e7 },
+    { 0x443, 0x304, 0x4ef }, { 0x443, 0x306, 0x45e }, { 0x443, 0x308, 0x4f1 },
+    { 0x443, 0x30b, 0x4f3 }, { 0x447, 0x308, 0x4f5 }, { 0x44b, 0x308, 0x4f9 },
+    { 0x44d, 0x308, 0x4ed }, { 0x456, 0x308, 0x457 }, { 0x474, 0x30f, 0x476 },
+    { 0x475, 0x30f, 0x477 }, { 0x4d8, 0x308, 0x4da }, { 0x4d9, 0x308, 0x4db },
+    { 0x4e8, 0x308, 0x4ea }, { 0x4e9, 0x308, 0x4eb }, { 0x1e36, 0x304, 0x1e38 },
+    { 0x1e37, 0x304, 0x1e39 }, { 0x1e5a, 0x304, 0x1e5c }, { 0x1e5b, 0x304, 0x1e5d },
+    { 0x1e62, 0x307, 0x1e68 }, { 0x1e63, 0x307, 0x1e69 }, { 0x1ea0, 0x302, 0x1eac },
+    { 0x1ea0, 0x306, 0x1eb6 }, { 0x1ea1, 0x302, 0x1ead }, { 0x1ea1, 0x306, 0x1eb7 },
+    { 0x1eb8, 0x302, 0x1ec6 }, { 0x1eb9, 0x302, 0x1ec7 }, { 0x1ecc, 0x302, 0x1ed8 },
+    { 0x1ecd, 0x302, 0x1ed9 }
+};
+
+constexpr bool
+sorted_compositions ()
+{
+    for (std::size_t i = 1; i < std::size (compositions); ++i)
+        if (compositions[i-1].base > compositions[i].base || (compositions[i-1].base
+                    == compositions[i].base && compositions[i-1].mark >= compositions[i].mark))
+            return false;
+    for (auto const& c: compositions)
+        if (c.mark < 0x300 || c.mark >= 0x340)
+            return false;
+    return true;
+}
+
+/// Also all of the marks are in U+0300-033F, these which lead with 0xcc in UTF-8
+static_assert (sorted_compositions ());
+
+inline char
+lower (char c)
+{
+    return c >= 'A' && c <= 'Z' ? char (c | 0x20) : c;
+}
+
+#ifdef UTF8_X86
+
+/// Sets bit 5 of the bytes in A-Z
+inline __m128i
+lower (__m128i x)
+{
+    auto shifted = _mm_add_epi8 (x, _mm_set1_epi8 (char (0x80 - 'A')));
+    auto upper = _mm_cmplt_epi8 (shifted, _mm_set1_epi8 (char (0x80 + 26)));
+    return _mm_or_si128 (x, _mm_and_si128 (upper, _mm_set1_epi8 (0x20)));
+}
+
+#endif
+
+/// Appends the ASCII @p s in lower case to @p out
+void
+fold_ascii (std::string_view s, std::string& out)
+{
+    auto at = out.size ();
+    out.resize (at + s.size ());
+    auto dst = out.data () + at;
+    std::size_t i = 0;
+#ifdef UTF8_X86
+    for (; i + 16 <= s.size (); i += 16)
+        _mm_storeu_si128 (reinterpret_cast<__m128i*> (dst + i),
+                lower (_mm_loadu_si128 (reinterpret_cast<const __m128i*> (s.data () + i))));
+#endif
+    for (; i < s.size (); ++i)
+        dst[i] = lower (s[i]);
+}
+
+}
+
+//--------------------------------------------------------------------------------------------------
+
+std::size_t
+utf8_decode (std::string_view s, std::size_t i, char32_t& cp)
+{
+    auto c = std::uint8_t (s[i]);
+    auto const& l = leads[c];
+    if (l.size == 1)
+    {
+        cp = c;
+        return 1;
+    }
+    cp = 0xfffd;
+    if (!l.size || l.size > s.size () - i)
+        return 1;
+    auto b = std::uint8_t (s[i + 1]);
+    if (b < l.low || b > l.high)
+        return 1;
+    char32_t v = (c & l.bits) << 6 | (b & 0x3f);
+    for (std::size_t k = 2; k < l.size; ++k)
+    {
+        b = std::uint8_t (s[i + k]);
+        if ((b & 0xc0) != 0x80)
+            return 1;
+        v = v << 6 | (b & 0x3f);
+    }
+    cp = v;
+    return l.size;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+char32_t
+utf8_compose (char32_t base, char32_t mark)
+{
+    if (mark < 0x300 || mark >= 0x340 || base > 0xffff)
+        return 0;
+    auto it = std::lower_bound (std::begin (compositions), std::end (compositions),
+            compose_t { char16_t (base), char16_t (mark), 0 },
+            [] (compose_t const& a, compose_t const& b) {
+                return a.base < b.base || (a.base == b.base && a.mark < b.mark);
+            });
+    if (it == std::end (compositions) || it->base != base || it->mark != mark)
+        return 0;
+    return it->composed;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+std::size_t
+utf8_decode_nfc (std::string_view s, std::size_t i, char32_t& cp)
+{
+    auto n = utf8_decode (s, i, cp);
+    if (n == 1 && (s[i] & 0x80))
+        return n;
+    while (i + n + 1 < s.size () && std::uint8_t (s[i + n]) == 0xcc)
+    {
+        char32_t mark;
+        auto m = utf8_decode (s, i + n, mark);
+        auto c = utf8_compose (cp, mark);
+        if (!c)
+            break;
+        cp = c;
+        n += m;
+    }
+    return n;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void
+utf8_append (std::string& out, char32_t cp)
+{
+    if (cp < 0x80)
+        out += char (cp);
+    else if (cp < 0x800)
+    {
+        out += char (0xc0 | cp >> 6);
+        out += char (0x80 | (cp & 0x3f));
+    }
+    else if (cp < 0x10000)
+    {
+        out += char (0xe0 | cp >> 12);
+        out += char (0x80 | (cp >> 6 & 0x3f));
+        out += char (0x80 | (cp & 0x3f));
+    }
+    else
+    {
+        out += char (0xf0 | cp >> 18);
+        out += char (0x80 | (cp >> 12 & 0x3f));
+        out += char (0x80 | (cp >> 6 & 0x3f));
+        out += char (0x80 | (cp & 0x3f));
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+std::size_t
+ascii_prefix (std::string_view s, std::size_t pos)
+{
+    auto i = pos;
+#ifdef UTF8_X86
+    for (; i + 16 <= s.size (); i += 16)
+    {
+        // The high bit of each byte, set only in the multi-byte sequences
+        unsigned mask = _mm_movemask_epi8 (
+                _mm_loadu_si128 (reinterpret_cast<const __m128i*> (s.data () + i)));
+        if (mask)
+            return i + __builtin_ctz (mask);
+    }
+#endif
+    while (i < s.size () && !(s[i] & 0x80))
+        ++i;
+    return i;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+char32_t
+fold_case (char32_t cp)
+{
+    if (cp >= 0x10000)
+        return cp;
+    return cp + fold_tables.deltas[fold_tables.blocks[cp >> 8]][cp & 0xff];
+}
+
+//--------------------------------------------------------------------------------------------------
+
+std::string
+fold_utf8 (std::string_view s)
+{
+    std::string out;
+    out.reserve (s.size ());
+    for (std::size_t i = 0; i < s.size (); )
+    {
+        // The last ASCII letter may compose with the marks after it
+        auto k = ascii_prefix (s, i);
+        if (k > i && k < s.size ())
+            --k;
+        fold_ascii (s.substr (i, k - i), out);
+        if ((i = k) == s.size ())
+            break;
+        char32_t cp;
+        auto n = utf8_decode_nfc (s, i, cp);
+        if (n == 1 && (s[i] & 0x80))
+            out += s[i];
+        else
+            utf8_append (out, fold_case (cp));
+        i += n;
+    }
+    return out;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool
+is_space (char32_t cp)
+{
+    if (cp < 0x80)
+        return cp == ' ' || (cp >= '\t' && cp <= '\r');
+    return cp == 0x85 || cp == 0xa0 || cp == 0x1680 || (cp >= 0x2000 && cp <= 0x200a)
+        || cp == 0x2028 || cp == 0x2029 || cp == 0x202f || cp == 0x205f || cp == 0x3000;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool
+is_control (char32_t cp)
+{
+    return cp < 0x20 || (cp >= 0x7f && cp <= 0x9f);
+}
+
+//--------------------------------------------------------------------------------------------------
+
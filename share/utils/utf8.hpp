@@ -0,0 +1,78 @@
+/**
+ * @file utf8.hpp
+ * @internal
+ *
+ * This file is part of General Utilities project (aka Utils).
+ *
+ *   Utils is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Utils is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Utils If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Utilities
+ *
+ * @details
+ * UTF-8 decoding, classification and case folding, for the text scanning code which should not
+ * take the bytes of the multi-byte sequences for characters (as the <cctype> functions do).
+ *
+ * The decoding and the folding are driven by tables generated at compile time. The folding is
+ * the simple (one to one) lower casing of the Latin, Greek, Cyrillic, Armenian and fullwidth
+ * Latin letters, the rest of the code points fold to themselves. The ASCII runs, most of the
+ * text of the Latin script books, are skipped or folded 16 bytes at a time.
+ *
+ * The normalization is the canonical composition (NFC) of the precomposed Latin (U+00C0-024F,
+ * U+1E00-1EFF) and Cyrillic (U+0400-04FF) letters only, enough for "e" and U+0301 to be "é" when
+ * searched and indexed. A combining mark which does not compose with the letter before it ends
+ * the composition, the reordering of the marks by their combining class is not done.
+ */
+
+#ifndef UTF8_HPP
+#define UTF8_HPP
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+//--------------------------------------------------------------------------------------------------
+
+/// The code point at @p i, returns its bytes, or one for an invalid sequence decoded as U+FFFD
+std::size_t utf8_decode (std::string_view s, std::size_t i, char32_t& cp);
+
+/// As utf8_decode (), with the combining marks after the code point composed into it, if any
+std::size_t utf8_decode_nfc (std::string_view s, std::size_t i, char32_t& cp);
+
+/// The precomposed letter of @p base and the combining @p mark, zero if there is none
+char32_t utf8_compose (char32_t base, char32_t mark);
+
+/// Appends the UTF-8 sequence of @p cp to @p out
+void utf8_append (std::string& out, char32_t cp);
+
+/// The first non ASCII byte from @p pos on, or the size of @p s if none
+std::size_t ascii_prefix (std::string_view s, std::size_t pos = 0);
+
+/// The lower case of @p cp, if covered
+char32_t fold_case (char32_t cp);
+
+/// @p s composed as of utf8_decode_nfc () and with fold_case () applied, the invalid bytes kept
+std::string fold_utf8 (std::string_view s);
+
+/// The Unicode White_Space code points, no-break spaces included
+bool is_space (char32_t cp);
+
+/// The C0 and C1 control codes
+bool is_control (char32_t cp);
+
+//--------------------------------------------------------------------------------------------------
+
+#endif
+
@@ -0,0 +1,653 @@
+/**
+ * @file editlog.cpp
+ * @brief Write-ahead log of the book edits, for recovery after crashes
+ * @internal
+ *
+ * This file is part of Skyrim SE Journal mod (aka Journal).
+ *
+ *   Journal is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Journal is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Journal. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Core
+ *
+ * @details
+ * Every change made to the default book since it was last saved is appended to a log file next to
+ * it. On the next start, the log is replayed over the loaded default book. Once the book is saved
+ * into the default book, the records up to the save are dropped, a Save As elsewhere keeps them.
+ *
+ * Only page edits are logged, so the start always opens the default book. Loading another book
+ * empties the log, and nothing is logged until that book is saved as the default one. As the
+ * plugin is not told when the game quits, the edits of the default book are replayed after a quit
+ * without saving as well as after a crash.
+ *
+ * Instead of hooking each and every UI widget, the log compares the book at the end of each
+ * frame with a shadow of its last logged state. The shadow holds only the page ids, plus the
+ * content and the image of the two visible pages - the only ones which can be typed in. The
+ * titles are marked through touch_title (), the pages changed otherwise through touch_page (),
+ * these are logged whole.
+ *
+ * The log starts with "SSEJLOG1", followed by records of u8 operation, u32 payload size, the
+ * payload and an u32 FNV-1a hash of the operation and the payload. A torn record at the end, as
+ * left by a crash, ends the replay and is cut off. The payloads, with u32 size prefixed texts:
+ *
+ * Insert:  u32 index, u32 count and for each page: text title, text content, text image file,
+ *          u8 background, u32 tint, f32 uv[4], f32 xy[4]
+ * Erase:   u32 index, u32 count
+ * Title:   u32 index, text title
+ * Content: u32 index, u32 offset, u32 erased bytes (all past the offset if ~0), text inserted
+ * Image:   u32 index, text image file, u8 background, u32 tint, f32 uv[4], f32 xy[4]
+ */
+
+#include "sse-journal.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <unordered_map>
+#include <string_view>
+#include <iterator>
+#include <cstring>
+
+//--------------------------------------------------------------------------------------------------
+
+namespace {
+
+constexpr char log_magic[8] = { 'S', 'S', 'E', 'J', 'L', 'O', 'G', '1' };
+
+/// Operation 1 is not used, the older logs with it stop the replay there
+enum : std::uint8_t { op_insert = 2, op_erase, op_title, op_content, op_image };
+
+constexpr std::uint32_t whole = ~std::uint32_t (0);
+
+/// What is needed to tell a change in the visible pages
+struct shadow_t
+{
+    std::string content;
+    image_t image;
+};
+
+struct
+{
+    std::ofstream stream;
+    std::uint64_t size;         ///< Of the log file
+    bool reset = true;          ///< Book replaced, the shadow is to be rebuilt, nothing logged
+    bool based = true;          ///< The book is the default book plus the logged records
+    bool rebasing = false;      ///< Based by the save in progress into the default book
+    std::uint64_t version;      ///< Of the pages order, when the ids were taken
+    std::vector<std::uint32_t> ids;
+    std::unordered_map<std::uint32_t, shadow_t> visible;
+    std::vector<std::uint32_t> touched;
+    std::vector<std::uint32_t> titled;
+}
+edit_log;
+
+//--------------------------------------------------------------------------------------------------
+
+/// Builds a record payload
+struct record_t
+{
+    std::string bytes;
+
+    template<class T>
+    record_t& pod (T const& v)
+    {
+        bytes.append (reinterpret_cast<const char*> (&v), sizeof (T));
+        return *this;
+    }
+
+    record_t& text (std::string_view s)
+    {
+        pod (std::uint32_t (s.size ()));
+        bytes.append (s);
+        return *this;
+    }
+
+    record_t& image (image_t const& img)
+    {
+        text (img.file);
+        pod (std::uint8_t (img.background)).pod (img.tint).pod (img.uv).pod (img.xy);
+        return *this;
+    }
+};
+
+/// Reads a record payload back
+struct reader_t
+{
+    const char* p;
+    const char* end;
+
+    template<class T>
+    T pod ()
+    {
+        T v;
+        if (std::size_t (end - p) < sizeof (T))
+            throw std::runtime_error ("Truncated edit log record");
+        std::memcpy (&v, p, sizeof (T));
+        p += sizeof (T);
+        return v;
+    }
+
+    std::string text ()
+    {
+        auto n = pod<std::uint32_t> ();
+        if (std::size_t (end - p) < n)
+            throw std::runtime_error ("Truncated edit log record");
+        std::string s (p, n);
+        p += n;
+        return s;
+    }
+
+    void image (image_t& img)
+    {
+        assign_image (text (), img);
+        img.background = pod<std::uint8_t> ();
+        img.tint = pod<std::uint32_t> ();
+        img.uv = pod<decltype (img.uv)> ();
+        img.xy = pod<decltype (img.xy)> ();
+    }
+};
+
+std::uint32_t
+fnv1a (std::uint8_t op, std::string_view bytes)
+{
+    std::uint32_t h = (2166136261u ^ op) * 16777619u;
+    for (unsigned char c: bytes)
+        h = (h ^ c) * 16777619u;
+    return h;
+}
+
+/// Returns the bytes written
+std::uint64_t
+write_record (std::ostream& os, std::uint8_t op, record_t const& r)
+{
+    os.put (char (op));
+    auto n = std::uint32_t (r.bytes.size ());
+    os.write (reinterpret_cast<const char*> (&n), sizeof (n));
+    os.write (r.bytes.data (), n);
+    auto h = fnv1a (op, r.bytes);
+    os.write (reinterpret_cast<const char*> (&h), sizeof (h));
+    return 1 + sizeof (n) + n + sizeof (h);
+}
+
+void
+append (std::uint8_t op, record_t const& r)
+{
+    edit_log.size += write_record (edit_log.stream, op, r);
+}
+
+/// Drops all the records
+void
+empty_log ()
+{
+    edit_log.stream.close ();
+    {
+        std::ofstream of (edit_log_location, std::ios::binary);
+        of.write (log_magic, sizeof (log_magic));
+    }
+    edit_log.stream.open (edit_log_location, std::ios::binary | std::ios::app);
+    if (!edit_log.stream.is_open ())
+        log () << "Unable to open " << edit_log_location << " for appending." << std::endl;
+    edit_log.size = sizeof (log_magic);
+    edit_log.reset = true;
+}
+
+inline bool
+same_image (image_t const& a, image_t const& b)
+{
+    return a.file == b.file && a.background == b.background && a.tint == b.tint
+        && a.uv == b.uv && a.xy == b.xy;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void
+rebuild_shadow ()
+{
+    edit_log.reset = false;
+    edit_log.touched.clear ();
+    edit_log.titled.clear ();
+    edit_log.visible.clear ();
+    edit_log.ids.clear ();
+    edit_log.version = journal.pages.version ();
+    for (auto const& p: journal.pages)
+        edit_log.ids.push_back (p.id);
+}
+
+/// The pages with any of the @p ids and their indices, looked for in the visible pages first
+std::vector<std::pair<std::uint32_t, page_t*>>
+find_pages (std::vector<std::uint32_t>& ids)
+{
+    std::sort (ids.begin (), ids.end ());
+    ids.erase (std::unique (ids.begin (), ids.end ()), ids.end ());
+
+    std::vector<std::pair<std::uint32_t, page_t*>> found;
+    auto& pages = journal.pages;
+    auto first = std::min<std::size_t> (journal.current_page, pages.size ());
+    auto it = pages.begin () + first;
+    for (auto i = first; i < first + 2 && i < pages.size (); ++i, ++it)
+        if (std::binary_search (ids.begin (), ids.end (), it->id))
+            found.emplace_back (std::uint32_t (i), &*it);
+
+    if (found.size () < ids.size ())
+    {
+        found.clear ();
+        std::uint32_t i = 0;
+        for (auto& p: pages)
+        {
+            if (std::binary_search (ids.begin (), ids.end (), p.id))
+                found.emplace_back (i, &p);
+            ++i;
+        }
+    }
+    ids.clear ();
+    return found;
+}
+
+/// Page inserts and erases, found as the one changed range between the logged and current order
+bool
+log_structure ()
+{
+    auto& ids = edit_log.ids;
+    auto& pages = journal.pages;
+    if (std::exchange (edit_log.version, pages.version ()) == pages.version ())
+        return false;
+    if (ids.size () == pages.size () && std::equal (ids.begin (), ids.end (), pages.begin (),
+                [] (auto id, page_t const& p) { return id == p.id; }))
+        return false;
+
+    std::size_t n = std::min (ids.size (), pages.size ()), prefix = 0, suffix = 0;
+    for (auto it = pages.begin (); prefix < n && ids[prefix] == it->id; ++it)
+        ++prefix;
+    for (auto it = pages.end () - 1; suffix < n - prefix
+            && ids[ids.size () - 1 - suffix] == it->id; --it)
+        ++suffix;
+
+    auto erased = ids.size () - prefix - suffix;
+    auto inserted = pages.size () - prefix - suffix;
+    if (erased)
+    {
+        append (op_erase, record_t {}.pod (std::uint32_t (prefix)).pod (std::uint32_t (erased)));
+        ids.erase (ids.begin () + prefix, ids.begin () + prefix + erased);
+    }
+    if (inserted)
+    {
+        record_t r;
+        r.pod (std::uint32_t (prefix)).pod (std::uint32_t (inserted));
+        auto it = pages.begin () + prefix;
+        for (std::size_t i = prefix; i < prefix + inserted; ++i, ++it)
+        {
+            auto& p = *it;
+            fetch_page (p);
+            r.text (p.title).text (p.content);
+            r.image (p.image);
+            ids.insert (ids.begin () + i, p.id);
+        }
+        append (op_insert, r);
+    }
+    return true;
+}
+
+bool
+log_titles ()
+{
+    if (edit_log.titled.empty ())
+        return false;
+    for (auto [i, p]: find_pages (edit_log.titled))
+        append (op_title, record_t {}.pod (i).text (p->title));
+    return true;
+}
+
+/// The replaced range of the visible pages, or the whole content and image of any other page
+bool
+log_touched ()
+{
+    if (edit_log.touched.empty ())
+        return false;
+    for (auto [i, page]: find_pages (edit_log.touched))
+    {
+        auto& p = *page;
+        auto content = p.content.view ();
+        auto it = edit_log.visible.find (p.id);
+        if (it == edit_log.visible.end ())
+        {
+            append (op_content, record_t {}.pod (i).pod (std::uint32_t (0))
+                    .pod (whole).text (content));
+            append (op_image, record_t {}.pod (i).image (p.image));
+            continue;
+        }
+
+        auto& shadow = it->second;
+        std::string_view old (shadow.content);
+        if (old != content)
+        {
+            std::size_t n = std::min (old.size (), content.size ()), prefix = 0, suffix = 0;
+            while (prefix < n && old[prefix] == content[prefix])
+                ++prefix;
+            while (suffix < n - prefix
+                    && old[old.size () - 1 - suffix] == content[content.size () - 1 - suffix])
+                ++suffix;
+            append (op_content, record_t {}.pod (i).pod (std::uint32_t (prefix))
+                    .pod (std::uint32_t (old.size () - prefix - suffix))
+                    .text (content.substr (prefix, content.size () - prefix - suffix)));
+            shadow.content = content;
+        }
+        if (!same_image (shadow.image, p.image))
+        {
+            shadow.image = p.image;
+            append (op_image, record_t {}.pod (i).image (p.image));
+        }
+    }
+    return true;
+}
+
+/// Keeps in the shadow only the currently visible pages
+void
+refresh_visible ()
+{
+    auto& visible = edit_log.visible;
+    auto first = journal.current_page;
+    auto is_visible = [first] (std::uint32_t id) {
+        return (first < journal.pages.size () && journal.pages[first].id == id)
+            || (first + 1 < journal.pages.size () && journal.pages[first + 1].id == id);
+    };
+    for (auto it = visible.begin (); it != visible.end (); )
+        if (is_visible (it->first)) ++it;
+        else it = visible.erase (it);
+
+    for (auto i = first; i < first + 2 && i < journal.pages.size (); ++i)
+    {
+        auto& p = journal.pages[i];
+        if (p.loaded && !visible.count (p.id))
+            visible.emplace (p.id, shadow_t { std::string (p.content), p.image });
+    }
+}
+
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void
+touch_page (page_t& page)
+{
+    page.dirty = true;
+    index_page (page);
+    if (edit_log.stream.is_open ())
+        edit_log.touched.push_back (page.id);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void
+touch_title (page_t const& page)
+{
+    if (edit_log.stream.is_open ())
+        edit_log.titled.push_back (page.id);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void
+log_edits ()
+{
+    if (!edit_log.stream.is_open ())
+        return;
+    if (!edit_log.based)
+    {
+        // Nothing to replay these over, until the book is saved as the default one
+        edit_log.reset = true;
+        edit_log.touched.clear ();
+        edit_log.titled.clear ();
+        return;
+    }
+    if (edit_log.reset)
+        rebuild_shadow ();
+
+    bool logged = log_structure ();
+    logged = log_titles () || logged;
+    logged = log_touched () || logged;
+    refresh_visible ();
+
+    if (logged && !edit_log.stream.flush ())
+    {
+        log () << "Unable to write the edit log, closing it." << std::endl;
+        edit_log.stream.close ();
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// The records are of the replaced book, the log goes on only if the default book is loaded
+void
+log_loaded (std::string const& source)
+{
+    if (!edit_log.stream.is_open ())
+        return;
+    empty_log ();
+    edit_log.based = source == default_book;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static void
+apply (std::uint8_t op, reader_t& r)
+{
+    auto& pages = journal.pages;
+    auto page = [&pages] (std::uint32_t i, bool content = true) -> page_t& {
+        if (i >= pages.size ())
+            throw std::runtime_error ("Edit log page out of range");
+        if (!fetch_page (pages[i]) && pages[i].broken && content)
+            throw std::runtime_error ("Edit log page could not be read");
+        index_page (pages[i]);
+        return pages[i];
+    };
+
+    switch (op)
+    {
+        case op_insert:
+        {
+            auto at = r.pod<std::uint32_t> ();
+            auto n = r.pod<std::uint32_t> ();
+            if (at > pages.size ())
+                throw std::runtime_error ("Edit log page out of range");
+            std::vector<page_t> inserted (n);
+            for (auto& p: inserted)
+            {
+                p.title = r.text ();
+                p.content = r.text ();
+                r.image (p.image);
+            }
+            pages.insert (pages.begin () + at, std::make_move_iterator (inserted.begin ()),
+                                               std::make_move_iterator (inserted.end ()));
+            break;
+        }
+        case op_erase:
+        {
+            auto at = r.pod<std::uint32_t> ();
+            auto n = r.pod<std::uint32_t> ();
+            if (at > pages.size () || n > pages.size () - at)
+                throw std::runtime_error ("Edit log page out of range");
+            pages.erase (pages.begin () + at, pages.begin () + at + n);
+            break;
+        }
+        case op_title:
+        {
+            auto& p = page (r.pod<std::uint32_t> (), false);
+            p.title = r.text ();
+            break;
+        }
+        case op_content:
+        {
+            auto& p = page (r.pod<std::uint32_t> ());
+            auto offset = r.pod<std::uint32_t> ();
+            auto erased = r.pod<std::uint32_t> ();
+            if (offset > p.content.size ())
+                throw std::runtime_error ("Edit log offset out of range");
+            p.content.replace (offset, std::min<std::size_t> (erased, p.content.size () - offset),
+                               r.text ());
+            p.dirty = true;
+            break;
+        }
+        case op_image:
+        {
+            auto& p = page (r.pod<std::uint32_t> ());
+            r.image (p.image);
+            p.dirty = true;
+            break;
+        }
+        default:
+            throw std::runtime_error ("Unknown edit log operation");
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Replays the log over the just loaded default book, then opens it for appending. Whatever can't
+ * be replayed (torn or corrupted records) is cut off, so that the new records follow a valid one.
+ */
+
+bool
+replay_edit_log ()
+{
+    bool ok = true, magic = false;
+    std::uint64_t valid = sizeof (log_magic);
+    std::size_t count = 0;
+
+    if (std::filesystem::exists (edit_log_location)) try
+    {
+        std::ifstream fi (edit_log_location, std::ios::binary);
+        std::string bytes {std::istreambuf_iterator<char> (fi), std::istreambuf_iterator<char> ()};
+        magic = bytes.size () >= sizeof (log_magic)
+            && !std::memcmp (bytes.data (), log_magic, sizeof (log_magic));
+        if (!magic)
+            throw std::runtime_error ("Not an edit log");
+
+        reader_t r { bytes.data () + valid, bytes.data () + bytes.size () };
+        while (r.p != r.end)
+        {
+            auto op = r.pod<std::uint8_t> ();
+            auto n = r.pod<std::uint32_t> ();
+            if (std::size_t (r.end - r.p) < n + sizeof (std::uint32_t))
+                throw std::runtime_error ("Truncated edit log record");
+            reader_t payload { r.p, r.p + n };
+            r.p += n;
+            if (r.pod<std::uint32_t> () != fnv1a (op, std::string_view (payload.p, n)))
+                throw std::runtime_error ("Corrupted edit log record");
+            apply (op, payload);
+            valid = r.p - bytes.data ();
+            ++count;
+        }
+    }
+    catch (std::exception const& ex)
+    {
+        log () << "Edit log replay stopped after " << count << " records: " << ex.what ()
+               << std::endl;
+        ok = false;
+    }
+
+    if (journal.current_page + 2 >= journal.pages.size ())
+        journal.current_page = 0;
+    if (count)
+        log () << "Recovered " << count << " edits from " << edit_log_location << std::endl;
+
+    try
+    {
+        if (!ok && magic)
+            std::filesystem::resize_file (edit_log_location, valid);
+        else if (!count)
+        {
+            std::ofstream of (edit_log_location, std::ios::binary);
+            of.write (log_magic, sizeof (log_magic));
+        }
+    }
+    catch (std::exception const& ex)
+    {
+        log () << "Unable to trim " << edit_log_location << ": " << ex.what () << std::endl;
+    }
+
+    edit_log.stream.open (edit_log_location, std::ios::binary | std::ios::app);
+    if (!edit_log.stream.is_open ())
+    {
+        log () << "Unable to open " << edit_log_location << " for appending." << std::endl;
+        return false;
+    }
+    edit_log.size = std::filesystem::file_size (edit_log_location);
+    edit_log.reset = true;
+    return ok;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// A book not based on the default one is from now on, if saved into it
+std::uint64_t
+edit_log_mark (std::string const& destination)
+{
+    if (edit_log.stream.is_open () && !edit_log.based && destination == default_book)
+    {
+        empty_log ();
+        edit_log.based = edit_log.rebasing = true;
+    }
+    log_edits ();
+    return edit_log.size;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// Drops the records up to the mark, once the default book includes them
+void
+fold_edit_log (std::uint64_t mark, std::string const& saved, bool ok)
+{
+    if (!edit_log.stream.is_open () || saved != default_book)
+        return;
+    if (!ok)
+    {
+        // The records since the mark are over a book which did not make it to the disk
+        if (std::exchange (edit_log.rebasing, false))
+        {
+            empty_log ();
+            edit_log.based = false;
+        }
+        return;
+    }
+    edit_log.rebasing = false;
+    edit_log.stream.close ();
+    try
+    {
+        std::string tail;
+        {
+            std::ifstream fi (edit_log_location, std::ios::binary);
+            fi.seekg (mark);
+            tail.assign (std::istreambuf_iterator<char> (fi), std::istreambuf_iterator<char> ());
+        }
+        auto temporary = edit_log_location + ".tmp";
+        std::uint64_t size = sizeof (log_magic) + tail.size ();
+        {
+            std::ofstream of (temporary, std::ios::binary);
+            of.write (log_magic, sizeof (log_magic));
+            of.write (tail.data (), tail.size ());
+            of.close ();
+            if (!of)
+                throw std::runtime_error ("Writing " + temporary + " failed");
+        }
+        std::filesystem::rename (temporary, edit_log_location);
+        edit_log.size = size;
+    }
+    catch (std::exception const& ex)
+    {
+        log () << "Unable to fold the edit log: " << ex.what () << std::endl;
+    }
+    edit_log.stream.open (edit_log_location, std::ios::binary | std::ios::app);
+}
+
+//--------------------------------------------------------------------------------------------------
+
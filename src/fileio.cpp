@@ -27,12 +27,29 @@
 
 #include "sse-journal.hpp"
 
-#include <rapidxml/rapidxml.hpp>
+#include <utils/mapfile.hpp>
+#include <utils/takenotes.hpp>
+#include <utils/lz.hpp>
+#include <utils/jsonwriter.hpp>
+#include <utils/utf8.hpp>
 #include <gsl/gsl_util>
 
 #include <fstream>
+#include <sstream>
+#include <filesystem>
 #include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <exception>
+#include <functional>
+#include <unordered_map>
 #include <iterator>
+#include <algorithm>
+#include <cstring>
+#include <charconv>
+#include <string_view>
 
 // Warning come in a BSON parser, which is not used, and probably shouldn't be
 #if defined(__GNUC__)
@@ -42,6 +59,7 @@
 #  include <nlohmann/json.hpp>
 #  pragma GCC diagnostic pop
 #endif
+#include <utils/jsonbook.hpp>
 
 //--------------------------------------------------------------------------------------------------
 
@@ -51,37 +69,657 @@ std::string default_book      = books_directory   + "default_book.json";
 std::string settings_location = journal_directory + "settings.json";
 std::string variables_location= journal_directory + "variables.json";
 std::string images_directory  = journal_directory + "images\\";
+std::string edit_log_location = books_directory   + "default_book.jlog";
 
 //--------------------------------------------------------------------------------------------------
 
+/**
+ * Binary book layout, all numbers are little endian as that is the only target anyway:
+ *
+ * Header: "SSEJBOOK", u32 major version, u32 current page, u32 page count, u32 flags, u64 offset
+ *         of the index
+ * Index:  for each page, u64 offset of its record and u32 size prefixed UTF-8 title
+ * Record: u32 size prefixed UTF-8 content, u32 size prefixed image file, u8 background, u32 tint,
+ *         f32 uv[4] and f32 xy[4]
+ *
+ * The titles are kept in the index, as the Chapters window lists all of them anyway. Opening a
+ * book reads only the header and the index, the records are read on demand by fetch_page ().
+ *
+ * With the packed flag (the *.jbz books), each record is stored as u32 record size, u32 block
+ * size and then the record compressed as an independent LZ block. So any page can be decompressed
+ * alone, and many of them can be (de)compressed in parallel.
+ */
+
+constexpr std::array<char, 8> binary_magic = {{ 'S', 'S', 'E', 'J', 'B', 'O', 'O', 'K' }};
+constexpr std::streamoff binary_tail_field = 12;  ///< Where the current page field starts
+constexpr std::streamoff binary_index_field = 24;
+constexpr std::uint32_t binary_packed = 1;      ///< Header flag for compressed records
+
+/// The binary book which the pages were read from or last saved to, for the not yet loaded ones
+static struct
+{
+    std::string file;
+    std::ifstream stream;
+    std::uint64_t compacted;    ///< File size after the last full rewrite (or on load)
+    std::uint64_t appended;     ///< Bytes appended by incremental saves since then
+    unsigned generation;        ///< Bumped on each book load, tells the saves apart
+    bool packed;                ///< Compressed records
+}
+binary_book;
+
+static void
+forget_binary_book ()
+{
+    binary_book.stream.close ();
+    binary_book.file.clear ();
+    binary_book.compacted = binary_book.appended = 0;
+    binary_book.generation++;
+    binary_book.packed = false;
+}
+
+/// Before the pages of the book being replaced are dropped
+static void
+release_book ()
+{
+    forget_edits ();
+    for (auto& p: journal.pages)
+        release_image (p.image);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static bool
+has_extension (std::string const& file, std::string const& ext)
+{
+    if (file.size () < ext.size ())
+        return false;
+    auto tail = std::string_view (file).substr (file.size () - ext.size ());
+    return fold_utf8 (tail) == fold_utf8 (ext);
+}
+
+/// The nlohmann encoding of a book file, JSON unless the extension says otherwise
+static nlohmann::detail::input_format_t
+book_format (std::string const& file)
+{
+    if (has_extension (file, ".cbor"))
+        return nlohmann::detail::input_format_t::cbor;
+    if (has_extension (file, ".msgpack"))
+        return nlohmann::detail::input_format_t::msgpack;
+    return nlohmann::detail::input_format_t::json;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+template<class T>
+static inline void
+write_pod (std::ostream& os, T const& v)
+{
+    os.write (reinterpret_cast<const char*> (&v), sizeof (T));
+}
+
+template<class T>
+static inline T
+read_pod (std::istream& is)
+{
+    T v;
+    if (!is.read (reinterpret_cast<char*> (&v), sizeof (T)))
+        throw std::runtime_error ("Unexpected end of binary book");
+    return v;
+}
+
+static inline void
+write_text (std::ostream& os, std::string_view s)
+{
+    write_pod (os, std::uint32_t (s.size ()));
+    os.write (s.data (), s.size ());
+}
+
+/// Reads straight into the target, so that it stays in its own text store
+template<class String>
+static void
+read_text (std::istream& is, String& s)
+{
+    s.resize (read_pod<std::uint32_t> (is));
+    if (!is.read (s.data (), s.size ()))
+        throw std::runtime_error ("Unexpected end of binary book");
+}
+
+static std::string
+read_text (std::istream& is)
+{
+    std::string s;
+    read_text (is, s);
+    return s;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// The page record body, the image file comes apart as it is kept in the journal images
+static void
+write_record (std::ostream& os, page_t const& p, std::string const& image_file)
+{
+    write_text (os, p.content);
+    write_text (os, image_file);
+    write_pod (os, std::uint8_t (p.image.background));
+    write_pod (os, p.image.tint);
+    write_pod (os, p.image.uv);
+    write_pod (os, p.image.xy);
+}
+
+static void
+read_record_body (std::istream& is, page_t& p, std::string& image_file)
+{
+    read_text (is, p.content);
+    read_text (is, image_file);
+    p.image.background = read_pod<std::uint8_t> (is);
+    p.image.tint = read_pod<std::uint32_t> (is);
+    p.image.uv = read_pod<decltype (p.image.uv)> (is);
+    p.image.xy = read_pod<decltype (p.image.xy)> (is);
+}
+
+/// Compressed page record, as read from a packed book
+struct block_t
+{
+    std::uint32_t size;     ///< Of the decompressed record
+    std::string packed;
+};
+
+/// The record compressed, along with its sizes, ready to be written in a packed book
+static std::string
+pack_record (page_t const& p, std::string const& image_file)
+{
+    std::ostringstream os;
+    write_record (os, p, image_file);
+    auto raw = os.str ();
+
+    std::string block (2 * sizeof (std::uint32_t), '\0');
+    lz_compress (raw.data (), raw.size (), block);
+    std::uint32_t sizes[2] = { std::uint32_t (raw.size ()),
+                               std::uint32_t (block.size () - 2 * sizeof (std::uint32_t)) };
+    std::memcpy (block.data (), sizes, sizeof (sizes));
+    return block;
+}
+
+static block_t
+read_block (std::istream& is, std::uint64_t offset)
+{
+    is.clear ();
+    if (!is.seekg (offset))
+        throw std::runtime_error ("Bad page record offset");
+    block_t b;
+    b.size = read_pod<std::uint32_t> (is);
+    b.packed.resize (read_pod<std::uint32_t> (is));
+    if (!is.read (b.packed.data (), b.packed.size ()))
+        throw std::runtime_error ("Unexpected end of binary book");
+    return b;
+}
+
+static void
+unpack_record (block_t const& b, page_t& p, std::string& image_file)
+{
+    std::string raw (b.size, '\0');
+    if (!lz_decompress (b.packed.data (), b.packed.size (), raw.data (), raw.size ()))
+        throw std::runtime_error ("Corrupted page record");
+    std::istringstream is (std::move (raw));
+    read_record_body (is, p, image_file);
+}
+
+static void
+read_record (std::istream& is, std::uint64_t offset, bool packed, page_t& p, std::string& image_file)
+{
+    if (packed)
+        return unpack_record (read_block (is, offset), p, image_file);
+    is.clear ();
+    if (!is.seekg (offset))
+        throw std::runtime_error ("Bad page record offset");
+    read_record_body (is, p, image_file);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// Calls @p fn for each index below @p n, spread across all cores. Rethrows the first failure.
+template<class Function>
+static void
+parallel_for (std::size_t n, Function&& fn)
+{
+    auto workers = std::min<std::size_t> (n, std::max (1u, std::thread::hardware_concurrency ()));
+    std::atomic<std::size_t> next = 0;
+    std::exception_ptr error;
+    std::mutex mutex;
+
+    auto work = [&]
+    {
+        try
+        {
+            for (std::size_t i; (i = next++) < n; )
+                fn (i);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock (mutex);
+            if (!error) error = std::current_exception ();
+            next = n;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (std::size_t i = 1; i < workers; ++i)
+        threads.emplace_back (work);
+    work ();
+    for (auto& t: threads)
+        t.join ();
+    if (error)
+        std::rethrow_exception (error);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// Marks the page as unreadable, so that it is neither retried each frame nor saved empty. A shelved
+/// page keeps its image and packed bytes, on which the saves fail (@see for_each_page)
+static void
+break_page (page_t& page)
+{
+    page.content.clear ();
+    if (page.packed.empty ())
+        page.image = image_t {};
+    page.broken = true;
+}
+
 bool
-save_text (std::string const& destination)
+fetch_page (page_t& page)
 {
-    int maj, min, patch;
-    const char* timestamp;
-    journal_version (&maj, &min, &patch, &timestamp);
+    if (page.loaded)
+        return true;
+    if (page.broken)
+        return false;
+    if (!page.packed.empty ())
+    {
+        if (!unshelve_page (page))
+        {
+            log () << "Unable to unshelve a page, it is kept read only" << std::endl;
+            break_page (page);
+        }
+        index_page (page);
+        return page.loaded;
+    }
 
     try
     {
-        std::ofstream of (destination);
-        if (!of.is_open ())
+        std::string file;
+        read_record (binary_book.stream, page.record, binary_book.packed, page, file);
+        page.loaded = true;
+        assign_image (file, page.image);
+    }
+    catch (std::exception const& ex)
+    {
+        log () << "Unable to fetch page from " << binary_book.file << ": " << ex.what () << std::endl;
+        break_page (page);
+    }
+    index_page (page);
+    return page.loaded;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// Packed books read the blocks in a row, but decompress them in parallel, as are the shelved pages
+bool
+fetch_pages ()
+{
+    std::vector<page_t*> shelved;
+    for (auto& p: journal.pages)
+        if (!p.loaded && !p.broken && !p.packed.empty ()) shelved.push_back (&p);
+    std::atomic<bool> unshelved = true;
+    parallel_for (shelved.size (), [&] (std::size_t i)
+    {
+        if (!unshelve_page (*shelved[i]))
+            unshelved = false;
+    });
+    for (auto p: shelved)
+    {
+        if (!p->loaded)
+            break_page (*p);
+        index_page (*p);
+    }
+    if (!unshelved)
+        log () << "Unable to unshelve pages, these are kept read only" << std::endl;
+
+    if (!binary_book.packed)
+    {
+        bool ok = unshelved;
+        for (auto& p: journal.pages)
+            ok = fetch_page (p) && ok;
+        return ok;
+    }
+
+    std::vector<page_t*> pending;
+    for (auto& p: journal.pages)
+        if (!p.loaded && !p.broken) pending.push_back (&p);
+    if (pending.empty ())
+        return unshelved;
+
+    // Each page on its own, a bad record breaks only its page
+    std::vector<std::string> files (pending.size ());
+    std::vector<std::string> errors (pending.size ());
+    std::vector<block_t> blocks (pending.size ());
+    for (std::size_t i = 0; i < pending.size (); ++i)
+        try { blocks[i] = read_block (binary_book.stream, pending[i]->record); }
+        catch (std::exception const& ex) { errors[i] = ex.what (); }
+    parallel_for (pending.size (), [&] (std::size_t i)
+    {
+        if (errors[i].empty ())
+            try { unpack_record (blocks[i], *pending[i], files[i]); }
+            catch (std::exception const& ex) { errors[i] = ex.what (); }
+    });
+
+    bool ok = true;
+    for (std::size_t i = 0; i < pending.size (); ++i)
+    {
+        auto& page = *pending[i];
+        if (errors[i].empty ())
         {
-            log () << "Unable to open " << destination << " for writting." << std::endl;
-            return false;
+            page.loaded = true;
+            assign_image (files[i], page.image);
+        }
+        else
+        {
+            log () << "Unable to fetch page from " << binary_book.file << ": " << errors[i]
+                   << std::endl;
+            break_page (page);
+            ok = false;
+        }
+        index_page (page);
+    }
+    return ok && unshelved;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * What a background save works on.
+ *
+ * Pages backed by a clean record in the binary book are not copied, only their title and record
+ * offset are. The saving thread reads them back from the book file on its own. So for the usual
+ * binary book with few edited pages, the snapshot costs next to nothing. Books which came from
+ * the other formats have no such records and are copied whole - still way cheaper than the
+ * serialization and the disk writes which are now off the render thread.
+ */
+
+struct snapshot_t
+{
+    struct entry_t
+    {
+        page_t page;
+        std::string image_file;
+        bool copied;    ///< Otherwise the content and image are in the #source record
+        bool dirty;     ///< As it was when the snapshot was taken
+    };
+    std::vector<entry_t> pages;
+    unsigned current;
+    std::string source;     ///< The binary book at the time of the snapshot
+    bool packed;            ///< The source has compressed records
+    unsigned generation;    ///< Of the binary book, changes on every book load
+    std::string stamp;      ///< Local time for the text exports
+};
+
+static std::shared_ptr<snapshot_t>
+take_snapshot (bool clear_dirty)
+{
+    auto snap = std::make_shared<snapshot_t> ();
+    snap->current = journal.current_page;
+    snap->source = binary_book.file;
+    snap->packed = binary_book.packed;
+    snap->generation = binary_book.generation;
+    snap->stamp = local_time ("%c");
+
+    snap->pages.resize (journal.pages.size ());
+    for (std::size_t i = 0; i < journal.pages.size (); ++i)
+    {
+        auto& p = journal.pages[i];
+        auto& e = snap->pages[i];
+        e.dirty = p.dirty;
+        e.copied = (p.loaded || !p.packed.empty ())
+            && (p.dirty || !p.record || snap->source.empty ());
+        if (e.copied)
+        {
+            e.page = p;
+            e.image_file = p.image.file;
         }
+        else
+        {
+            e.page.id = p.id;
+            e.page.title = p.title;
+            e.page.record = p.record;
+        }
+        if (clear_dirty)
+            p.dirty = false;
+    }
+    return snap;
+}
 
-        of << "SSE-Journal "<< maj<<'.'<< min <<'.'<< patch <<" ("<< timestamp << ")\n"
-           << journal.pages.size () << " pages exported on " << local_time ("%c") << '\n'
-           << std::endl;
+/// The snapshot copies of the shelved pages are decompressed by the saving thread
+static page_t const&
+unshelved (page_t const& p, page_t& temp)
+{
+    if (p.packed.empty ())
+        return p;
+    temp = p;
+    if (!unshelve_page (temp))
+        throw std::runtime_error ("Corrupted shelved page");
+    return temp;
+}
 
-        int i = 0;
-        for (auto const& p: journal.pages)
+/**
+ * Visits the snapshot pages, reading the not copied ones from the source book one at a time.
+ *
+ * These include the pages which could not be fetched or unshelved (@see page_t::broken). If still
+ * unreadable, the save fails, as writing them empty would lose their record or packed content.
+ */
+
+template<class Function>
+static void
+for_each_page (snapshot_t const& snap, Function&& visit)
+{
+    std::ifstream source;
+    page_t temp;
+    std::string file;
+    for (std::size_t i = 0; i < snap.pages.size (); ++i)
+    {
+        auto const& e = snap.pages[i];
+        if (e.copied)
+        {
+            visit (unshelved (e.page, temp), e.image_file);
+            continue;
+        }
+        if (!source.is_open ())
         {
-            of << "Page #" << std::to_string (i++) << '\n'
-               << p.title.c_str () << '\n'
-               << p.content.c_str () << '\n'
-               << std::endl;
+            source.open (snap.source, std::ios::binary);
+            if (!source.is_open ())
+                throw std::runtime_error ("Unable to open " + snap.source + " for reading");
         }
+        temp.title = e.page.title;
+        try
+        {
+            read_record (source, e.page.record, snap.packed, temp, file);
+        }
+        catch (std::exception const& ex)
+        {
+            throw std::runtime_error ("Unable to read page #" + std::to_string (i) + " of "
+                    + snap.source + ": " + ex.what ());
+        }
+        visit (temp, file);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// Background saving, one job at a time
+static struct saving_t
+{
+    std::thread worker;
+    std::atomic<bool> done;
+    bool ok, failed;
+    std::string error;
+    std::function<bool (bool)> finish;  ///< Called on the render thread with the job outcome
+    ~saving_t ()
+    {
+        if (worker.joinable ())
+            worker.join ();
+    }
+}
+saving;
+
+/// Applies the finished job, waiting for it if asked to. False if it failed.
+static bool
+finish_saving (bool wait)
+{
+    if (!saving.worker.joinable () || (!wait && !saving.done))
+        return true;
+    saving.worker.join ();
+    if (!saving.error.empty ())
+        log () << saving.error << std::endl;
+    bool ok = saving.finish (saving.ok);
+    saving.finish = nullptr;
+    saving.error.clear ();
+    saving.failed |= !ok;
+    return ok;
+}
+
+static void
+start_saving (std::function<void ()> job, std::function<bool (bool)> finish)
+{
+    finish_saving (true);
+    saving.done = false;
+    saving.finish = std::move (finish);
+    saving.worker = std::thread ([job = std::move (job)]
+    {
+        saving.ok = false;
+        try
+        {
+            job ();
+            saving.ok = true;
+        }
+        catch (std::exception const& ex)
+        {
+            saving.error = std::string ("Unable to save: ") + ex.what ();
+        }
+        saving.done = true;
+    });
+}
+
+/// Adds a step on the render thread, after the finish of the last started job
+static void
+then_saving (std::function<bool (bool)> next)
+{
+    saving.finish = [first = std::move (saving.finish), next = std::move (next)] (bool ok)
+    {
+        return next (first (ok));
+    };
+}
+
+/// The outcome of the last started job goes to @p saved, if any, and not to poll_saving ()
+static void
+report_saving (saved_t saved)
+{
+    if (saved)
+        then_saving ([saved = std::move (saved)] (bool ok)
+        {
+            saved (ok);
+            return true;
+        });
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool
+poll_saving ()
+{
+    finish_saving (false);
+    return !std::exchange (saving.failed, false);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// Drops the content and image of a clean page, to be fetched again from its binary book record
+bool
+release_page (page_t& page)
+{
+    // Until a save finishes, the records of the just cleaned pages are not there yet
+    if (!page.loaded || page.dirty || !page.record || !binary_book.stream.is_open ()
+            || saving.worker.joinable ())
+        return false;
+    page.content.release ();
+    release_image (page.image);
+    page.image = image_t {};
+    page.loaded = false;
+    index_page (page);
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// The content of a page, read into @p temp if not loaded, so that the page itself stays as it is
+std::string_view
+peek_content (page_t const& page, page_t& temp)
+{
+    if (page.loaded)
+        return page.content;
+    if (page.broken)
+        return {};
+    try
+    {
+        if (!page.packed.empty ())
+            return unshelved (page, temp).content;
+        std::string file;
+        read_record (binary_book.stream, page.record, binary_book.packed, temp, file);
+        return temp.content;
+    }
+    catch (std::exception const& ex)
+    {
+        log () << "Unable to read a page: " << ex.what () << std::endl;
+        return {};
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static void
+write_text_book (snapshot_t const& snap, std::string const& destination)
+{
+    int maj, min, patch;
+    const char* timestamp;
+    journal_version (&maj, &min, &patch, &timestamp);
+
+    std::ofstream of (destination);
+    if (!of.is_open ())
+        throw std::runtime_error ("Unable to open " + destination + " for writting");
+
+    of << "SSE-Journal "<< maj<<'.'<< min <<'.'<< patch <<" ("<< timestamp << ")\n"
+       << snap.pages.size () << " pages exported on " << snap.stamp << '\n'
+       << std::endl;
+
+    int i = 0;
+    for_each_page (snap, [&] (page_t const& p, std::string const&)
+    {
+        of << "Page #" << std::to_string (i++) << '\n'
+           << p.title.view () << '\n'
+           << p.content.view () << '\n'
+           << std::endl;
+    });
+
+    of.close ();
+    if (!of)
+        throw std::runtime_error ("Writing " + destination + " failed");
+}
+
+bool
+save_text (std::string const& destination, saved_t saved)
+{
+    try
+    {
+        auto snap = take_snapshot (false);
+        start_saving ([snap, destination] { write_text_book (*snap, destination); },
+                [] (bool ok) { return ok; });
+        report_saving (std::move (saved));
     }
     catch (std::exception const& ex)
     {
@@ -93,56 +731,413 @@ save_text (std::string const& destination)
 
 //--------------------------------------------------------------------------------------------------
 
-bool
-save_book (std::string const& destination)
+static void
+write_json_book (snapshot_t const& snap, std::string const& destination, bool compact)
 {
     int maj, min, patch;
     const char* timestamp;
     journal_version (&maj, &min, &patch, &timestamp);
 
-    try
+    std::ofstream of (destination, std::ios::binary);
+    if (!of.is_open ())
+        throw std::runtime_error ("Unable to open " + destination + " for writting");
+
+    json_writer json (of, !compact);
+    json.begin_object ();
+    json.begin_object ("version");
+    json.member ("major", maj);
+    json.member ("minor", min);
+    json.member ("patch", patch);
+    json.member ("timestamp", timestamp);
+    json.end_object ();
+    json.member ("size", snap.pages.size ());
+    json.member ("current", snap.current);
+
+    json.begin_object ("pages");
+    int i = 0;
+    for_each_page (snap, [&] (page_t const& p, std::string const& file)
     {
-        nlohmann::json json = {
-            { "version", {
-                { "major", maj },
-                { "minor", min },
-                { "patch", patch },
-                { "timestamp", timestamp }
-            }},
-            { "size", journal.pages.size () },
-            { "current", journal.current_page },
-            { "pages", nlohmann::json::object () }
+        json.begin_object (std::to_string (i++));
+        json.member ("title", p.title.view ());
+        json.member ("content", p.content.view ());
+        json.begin_object ("image");
+        json.member ("file", file);
+        json.member ("background", p.image.background);
+        json.member ("tint", hex_string (p.image.tint));
+        json.member ("uv", p.image.uv);
+        json.member ("xy", p.image.xy);
+        json.end_object ();
+        json.end_object ();
+    });
+    json.end_object ();
+    json.end_object ();
+    json.flush ();
+
+    of.close ();
+    if (!of)
+        throw std::runtime_error ("Writing " + destination + " failed");
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// Same schema as the JSON books, but put through the nlohmann CBOR or MessagePack writers
+static void
+write_encoded_book (snapshot_t const& snap, std::string const& destination,
+                    nlohmann::detail::input_format_t format)
+{
+    int maj, min, patch;
+    const char* timestamp;
+    journal_version (&maj, &min, &patch, &timestamp);
+
+    nlohmann::json json = {
+        { "version", {
+            { "major", maj },
+            { "minor", min },
+            { "patch", patch },
+            { "timestamp", timestamp }
+        }},
+        { "size", snap.pages.size () },
+        { "current", snap.current },
+        { "pages", nlohmann::json::object () }
+    };
+
+    int i = 0;
+    auto& pages = json["pages"];
+    for_each_page (snap, [&] (page_t const& p, std::string const& file)
+    {
+        pages[std::to_string (i++)] = {
+            { "title", std::string (p.title) },
+            { "content", std::string (p.content) },
+            { "image",  {
+                { "file", file },
+                { "background", p.image.background },
+                { "tint", hex_string (p.image.tint) },
+                { "uv", p.image.uv },
+                { "xy", p.image.xy }
+            }}
         };
+    });
+
+    std::ofstream of (destination, std::ios::binary);
+    if (!of.is_open ())
+        throw std::runtime_error ("Unable to open " + destination + " for writting");
+    if (format == nlohmann::detail::input_format_t::cbor)
+        nlohmann::json::to_cbor (json, of);
+    else
+        nlohmann::json::to_msgpack (json, of);
+    of.close ();
+    if (!of)
+        throw std::runtime_error ("Writing " + destination + " failed");
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// Current page, page count, flags and the index offset - all in one write
+static void
+write_header_tail (std::ostream& os, snapshot_t const& snap, bool packed, std::uint64_t index)
+{
+    write_pod (os, std::uint32_t (snap.current));
+    write_pod (os, std::uint32_t (snap.pages.size ()));
+    write_pod (os, packed ? binary_packed : std::uint32_t (0));
+    write_pod (os, index);
+}
+
+static std::uint64_t
+write_index (std::ostream& os, snapshot_t const& snap, std::vector<std::uint64_t> const& records)
+{
+    std::uint64_t index = os.tellp ();
+    for (std::size_t i = 0; i < snap.pages.size (); ++i)
+    {
+        write_pod (os, records[i]);
+        write_text (os, snap.pages[i].page.title);
+    }
+    return index;
+}
+
+/// Where the binary book job placed the page records, and how much it wrote
+struct binary_result_t
+{
+    std::vector<std::uint64_t> records;
+    std::uint64_t written;
+};
+
+/**
+ * Appends the dirty pages and a new index at the end of the current binary book.
+ *
+ * The previous records and index become garbage, but they are never overwritten. Hence until the
+ * final header write, the file stays what it was before. Only the header is updated in place.
+ */
+
+static void
+append_binary_book (snapshot_t const& snap, binary_result_t& result)
+{
+    std::fstream fo (snap.source, std::ios::in | std::ios::out | std::ios::binary);
+    if (!fo.is_open ())
+        throw std::runtime_error ("Unable to open " + snap.source + " for appending");
 
-        int i = 0;
-        for (auto const& p: journal.pages)
+    fo.seekp (0, std::ios::end);
+    std::uint64_t start = fo.tellp ();
+
+    page_t temp;
+    result.records.reserve (snap.pages.size ());
+    for (auto const& e: snap.pages)
+    {
+        if (e.copied)
         {
-            auto it = journal.images.find (p.image.ref);
-            json["pages"][std::to_string (i++)] = {
-                { "title", p.title.c_str () },
-                { "content", p.content.c_str () },
-                { "image",  {
-                    { "file", it == journal.images.end () ? "" : it->second.file.c_str () },
-                    { "background", p.image.background },
-                    { "tint", hex_string (p.image.tint) },
-                    { "uv", { p.image.uv[0], p.image.uv[1], p.image.uv[2], p.image.uv[3] }},
-                    { "xy", { p.image.xy[0], p.image.xy[1], p.image.xy[2], p.image.xy[3] }}
-                }}
-            };
+            auto const& page = unshelved (e.page, temp);
+            result.records.push_back (fo.tellp ());
+            if (snap.packed)
+            {
+                auto block = pack_record (page, e.image_file);
+                fo.write (block.data (), block.size ());
+            }
+            else write_record (fo, page, e.image_file);
         }
+        else result.records.push_back (e.page.record);
+    }
 
-        std::ofstream of (destination);
-        if (!of.is_open ())
+    auto index = write_index (fo, snap, result.records);
+    result.written = std::uint64_t (fo.tellp ()) - start;
+    fo.flush ();
+    fo.seekp (binary_tail_field);
+    write_header_tail (fo, snap, snap.packed, index);
+    fo.close ();
+    if (!fo)
+        throw std::runtime_error ("Appending to " + snap.source + " failed");
+}
+
+/**
+ * Packed pages are compressed in parallel, a batch at a time to keep the memory bounded. The clean
+ * records of a packed source are already compressed, so these are just copied over.
+ */
+
+static void
+write_packed_pages (std::ostream& os, snapshot_t const& snap, binary_result_t& result)
+{
+    constexpr std::size_t batch_size = 256;
+    std::vector<std::pair<page_t, std::string>> batch;
+    std::vector<std::string> blocks;
+    std::vector<std::size_t> slots;     ///< Of the batch pages in the result records
+
+    auto flush = [&]
+    {
+        blocks.resize (batch.size ());
+        parallel_for (batch.size (), [&] (std::size_t i)
+        {
+            auto& page = batch[i].first;
+            if (!page.packed.empty () && !unshelve_page (page))
+                throw std::runtime_error ("Corrupted shelved page");
+            blocks[i] = pack_record (page, batch[i].second);
+        });
+        for (std::size_t i = 0; i < batch.size (); ++i)
         {
-            log () << "Unable to open " << destination << " for writting." << std::endl;
+            result.records[slots[i]] = os.tellp ();
+            os.write (blocks[i].data (), blocks[i].size ());
+        }
+        batch.clear ();
+        slots.clear ();
+    };
+
+    std::ifstream source;
+    result.records.resize (snap.pages.size ());
+    for (std::size_t i = 0; i < snap.pages.size (); ++i)
+    {
+        auto const& e = snap.pages[i];
+        if (e.copied)
+        {
+            batch.emplace_back (e.page, e.image_file);
+            slots.push_back (i);
+            if (batch.size () == batch_size)
+                flush ();
+            continue;
+        }
+
+        if (!source.is_open ())
+        {
+            source.open (snap.source, std::ios::binary);
+            if (!source.is_open ())
+                throw std::runtime_error ("Unable to open " + snap.source + " for reading");
+        }
+        if (snap.packed)
+        {
+            auto b = read_block (source, e.page.record);
+            result.records[i] = os.tellp ();
+            std::uint32_t sizes[2] = { b.size, std::uint32_t (b.packed.size ()) };
+            os.write (reinterpret_cast<const char*> (sizes), sizeof (sizes));
+            os.write (b.packed.data (), b.packed.size ());
+            continue;
+        }
+
+        batch.emplace_back ();
+        batch.back ().first.title = e.page.title;
+        read_record (source, e.page.record, false, batch.back ().first, batch.back ().second);
+        slots.push_back (i);
+        if (batch.size () == batch_size)
+            flush ();
+    }
+    flush ();
+}
+
+/// Complete rewrite into a temporary file, which replaces the book once done
+static void
+write_binary_book (snapshot_t const& snap, std::string const& temporary, bool packed,
+                   binary_result_t& result)
+{
+    int maj;
+    journal_version (&maj, nullptr, nullptr, nullptr);
+
+    std::ofstream of (temporary, std::ios::binary);
+    if (!of.is_open ())
+        throw std::runtime_error ("Unable to open " + temporary + " for writting");
+
+    write_pod (of, binary_magic);
+    write_pod (of, std::uint32_t (maj));
+    write_header_tail (of, snap, packed, 0);
+
+    if (packed)
+        write_packed_pages (of, snap, result);
+    else
+    {
+        result.records.reserve (snap.pages.size ());
+        for_each_page (snap, [&] (page_t const& p, std::string const& file)
+        {
+            result.records.push_back (of.tellp ());
+            write_record (of, p, file);
+        });
+    }
+
+    auto index = write_index (of, snap, result.records);
+    result.written = of.tellp ();
+    of.seekp (binary_index_field);
+    write_pod (of, index);
+    of.close ();
+    if (!of)
+        throw std::runtime_error ("Writing " + temporary + " failed");
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Saving back into the book the pages came from writes only the dirty pages. Once the appended
+ * data outgrows the last compacted file size, the book is compacted through a full rewrite.
+ *
+ * The dirty flags are cleared upfront, so that edits made while the job runs mark the pages
+ * again. On failure, the snapshot dirty flags are put back. Pages are matched by their ids, as
+ * the book may be restructured meanwhile.
+ */
+
+static void
+save_binary_book (std::string const& destination, bool packed)
+{
+    bool append = destination == binary_book.file && binary_book.stream.is_open ()
+        && packed == binary_book.packed && binary_book.appended < binary_book.compacted;
+    auto snap = take_snapshot (true);
+    auto result = std::make_shared<binary_result_t> ();
+    auto temporary = destination + ".tmp";
+
+    start_saving ([=]
+    {
+        if (append) append_binary_book (*snap, *result);
+        else write_binary_book (*snap, temporary, packed, *result);
+    },
+    [=] (bool ok)
+    {
+        bool same_book = snap->generation == binary_book.generation;
+        if (ok && !append) try
+        {
+            if (binary_book.file == destination)
+                binary_book.stream.close ();
+            std::filesystem::rename (temporary, destination);
+        }
+        catch (std::exception const& ex)
+        {
+            log () << "Unable to replace " << destination << ": " << ex.what () << std::endl;
+            ok = false;
+        }
+
+        if (!ok && !append)
+        {
+            std::error_code ec;
+            std::filesystem::remove (temporary, ec);
+        }
+        if (!binary_book.stream.is_open () && !binary_book.file.empty ())
+            binary_book.stream.open (binary_book.file, std::ios::binary);
+        if (!same_book)
+            return ok; // Another book was loaded, so nothing to update
+
+        std::unordered_map<std::uint32_t, page_t*> pages;
+        for (auto& p: journal.pages)
+            pages.emplace (p.id, &p);
+        for (std::size_t i = 0; i < snap->pages.size (); ++i)
+        {
+            auto it = pages.find (snap->pages[i].page.id);
+            if (it == pages.end ())
+                continue;
+            if (ok) it->second->record = result->records[i];
+            else it->second->dirty |= snap->pages[i].dirty;
+        }
+        if (!ok)
             return false;
+
+        if (append)
+            binary_book.appended += result->written;
+        else
+        {
+            binary_book.stream.close ();
+            binary_book.stream.open (destination, std::ios::binary);
+            binary_book.file = destination;
+            binary_book.packed = packed;
+            binary_book.compacted = result->written;
+            binary_book.appended = 0;
+            drop_erased_records ();
         }
+        return true;
+    });
+}
 
-        of << json.dump (4);
+//--------------------------------------------------------------------------------------------------
+
+bool
+save_book (std::string const& destination, saved_t saved)
+{
+    try
+    {
+        // The edit log is folded once the book is saved into the default book, as the start
+        // replays it over that one. The previous job may fold it too, so it goes first.
+        finish_saving (true);
+        auto mark = edit_log_mark (destination);
+
+        if (has_extension (destination, ".jbook"))
+            save_binary_book (destination, false);
+        else if (has_extension (destination, ".jbz"))
+            save_binary_book (destination, true);
+        else if (book_format (destination) != nlohmann::detail::input_format_t::json)
+        {
+            auto format = book_format (destination);
+            auto snap = take_snapshot (false);
+            start_saving ([snap, destination, format]
+                    { write_encoded_book (*snap, destination, format); },
+                    [] (bool ok) { return ok; });
+        }
+        else
+        {
+            auto snap = take_snapshot (false);
+            start_saving ([snap, destination, compact = journal.compact_books]
+                    { write_json_book (*snap, destination, compact); },
+                    [] (bool ok) { return ok; });
+        }
+
+        then_saving ([mark, destination] (bool ok)
+        {
+            fold_edit_log (mark, destination, ok);
+            return ok;
+        });
+        report_saving (std::move (saved));
     }
     catch (std::exception const& ex)
     {
         log () << "Unable to save book: " << ex.what () << std::endl;
+        fold_edit_log (0, destination, false);
         return false;
     }
     return true;
@@ -150,71 +1145,143 @@ save_book (std::string const& destination)
 
 //--------------------------------------------------------------------------------------------------
 
-bool
-load_book (std::string const& source)
+static bool
+load_json_book (std::string const& source, nlohmann::detail::input_format_t format)
+{
+    try
+    {
+        int maj;
+        journal_version (&maj, nullptr, nullptr, nullptr);
+
+        mapped_file file (source);
+        auto texts = std::make_unique<text_store_t> (file.size (), journal.shelf.enabled);
+        json_book_sax<page_t> sax (texts->resource);
+        if (!parse_json_book (file, format, maj, sax))
+        {
+            log () << "Incompatible book version." << std::endl;
+            return false;
+        }
+
+        auto& pages = sax.pages;
+        release_book ();
+        journal.pages.clear ();
+        journal.texts = std::move (texts);
+        for (auto& p: pages)
+        {
+            if (p.has_image)
+                assign_image (p.image_file, p.page.image);
+            journal.pages.emplace_back (std::move (p.page));
+        }
+
+        while (journal.pages.size () < 2)
+        {
+            log () << "Less than two pages. Inserting empty one." << std::endl;
+            journal.pages.emplace_back (page_t {});
+        }
+
+        auto current = sax.current;
+        if (current >= journal.pages.size ())
+        {
+            log () << "Current page seems off. Setting it to the first one." << std::endl;
+            current = 0;
+        }
+        journal.current_page = current;
+        forget_binary_book ();
+    }
+    catch (std::exception const& ex)
+    {
+        log () << "Unable to load book: " << ex.what () << std::endl;
+        return false;
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+struct binary_header_t
+{
+    std::uint32_t current, count, flags;
+};
+
+/// Leaves the stream at the index, false if the book is of another version
+static bool
+read_binary_header (std::istream& fi, binary_header_t& h)
 {
     int maj;
     journal_version (&maj, nullptr, nullptr, nullptr);
 
+    if (read_pod<std::array<char, 8>> (fi) != binary_magic)
+        throw std::runtime_error ("Not a binary book");
+    if (read_pod<std::uint32_t> (fi) != std::uint32_t (maj))
+        return false;
+
+    h.current = read_pod<std::uint32_t> (fi);
+    h.count = read_pod<std::uint32_t> (fi);
+    h.flags = read_pod<std::uint32_t> (fi);
+    if (h.flags & ~binary_packed)
+        throw std::runtime_error ("Unknown binary book flags");
+    if (!fi.seekg (read_pod<std::uint64_t> (fi)))
+        throw std::runtime_error ("Bad index offset");
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static bool
+load_binary_book (std::string const& source)
+{
     try
     {
-        std::ifstream fi (source);
+        std::ifstream fi (source, std::ios::binary);
         if (!fi.is_open ())
         {
             log () << "Unable to open " << source << " for reading." << std::endl;
             return false;
         }
 
-        nlohmann::json json;
-        fi >> json;
-
-        if (json["version"]["major"].get<int> () != maj)
+        binary_header_t header;
+        if (!read_binary_header (fi, header))
         {
             log () << "Incompatible book version." << std::endl;
             return false;
         }
+        auto [current, count, flags] = header;
 
-        auto current = json["current"].get<unsigned> ();
-
-        std::map<int, page_t> pages; // a map for page sorting and gaps fixing
-        for (auto const& kv: json["pages"].items ())
+        // Only the titles for now, but the contents are fetched into the same store
+        auto texts = std::make_unique<text_store_t> (0, journal.shelf.enabled);
+        page_list_t pages;
+        for (std::uint32_t i = 0; i < count; ++i)
         {
-            page_t p = {};
-            int ndx = std::stoull (kv.key ());
-            auto& v = kv.value ();
-            p.title = v["title"].get<std::string> ();
-            p.content = v["content"].get<std::string> ();
-            if (v.contains ("image"))
-            {
-                auto& vi = v["image"];
-                auto it = vi["uv"].begin ();
-                for (float& uv: p.image.uv) uv = *it++;
-                it = vi["xy"].begin ();
-                for (float& xy: p.image.xy) xy = *it++;
-                p.image.tint = std::stoull (vi["tint"].get<std::string> (), nullptr, 0);
-                p.image.background = vi["background"];
-                obtain_image (vi["file"], p.image); // resets p.image on success
-            }
-            pages.emplace (ndx, std::move (p));
+            auto& p = pages.emplace_back (texts->resource);
+            p.record = read_pod<std::uint64_t> (fi);
+            read_text (fi, p.title);
+            p.loaded = false;
+            p.dirty = false;
         }
 
-        journal.pages.clear ();
-        journal.pages.reserve (pages.size ());
-        for (auto const& kv: pages)
-            journal.pages.emplace_back (std::move (kv.second));
-
-        while (journal.pages.size () < 2)
+        while (pages.size () < 2)
         {
             log () << "Less than two pages. Inserting empty one." << std::endl;
-            journal.pages.emplace_back (page_t {});
+            pages.emplace_back (page_t {});
         }
 
-        if (current >= journal.pages.size ())
+        if (current >= pages.size ())
         {
             log () << "Current page seems off. Setting it to the first one." << std::endl;
             current = 0;
         }
+
+        release_book ();
+        journal.pages = std::move (pages);
+        journal.texts = std::move (texts);
         journal.current_page = current;
+        fi.seekg (0, std::ios::end);
+        binary_book.compacted = fi.tellg ();
+        binary_book.appended = 0;
+        binary_book.generation++;
+        binary_book.packed = flags & binary_packed;
+        binary_book.stream = std::move (fi);
+        binary_book.file = source;
     }
     catch (std::exception const& ex)
     {
@@ -226,6 +1293,66 @@ load_book (std::string const& source)
 
 //--------------------------------------------------------------------------------------------------
 
+bool
+load_book (std::string const& source)
+{
+    finish_saving (true);
+    log_edits (); // Whatever was done to the book being replaced
+
+    bool ok;
+    if (has_extension (source, ".jbook") || has_extension (source, ".jbz"))
+        ok = load_binary_book (source);
+    else
+        ok = load_json_book (source, book_format (source));
+
+    if (ok)
+        log_loaded (source);
+    return ok;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static std::string
+default_book_as (bool binary)
+{
+    return books_directory + (binary ? "default_book.jbook" : "default_book.json");
+}
+
+/// The default book in the format chosen in the settings, JSON unless the binary one is opted in
+void
+select_default_book ()
+{
+    auto book = default_book_as (journal.binary_default);
+    if (book == default_book)
+        return;
+    log () << "Default book is now " << book << ", the older " << default_book
+           << " is kept, but no longer saved." << std::endl;
+    default_book = std::move (book);
+}
+
+/**
+ * The default book, or if not there yet, the one in the other format.
+ *
+ * Such is the case right after the format is switched in the settings. The next save writes the
+ * book in the chosen format, and the loads take it from then on.
+ */
+
+bool
+load_default_book ()
+{
+    if (std::filesystem::exists (default_book))
+        return load_book (default_book);
+
+    auto other = default_book_as (!journal.binary_default);
+    if (!std::filesystem::exists (other))
+        return false;
+    log () << "No " << default_book << " yet, loading " << other
+           << ", it will be saved in the new format." << std::endl;
+    return load_book (other);
+}
+
+//--------------------------------------------------------------------------------------------------
+
 static void
 save_font (nlohmann::json& json, font_t const& font)
 {
@@ -259,20 +1386,32 @@ save_settings ()
         };
 
         json["titlebar"] = journal.show_titlebar;
+        json["compact_books"] = journal.compact_books;
+        json["binary_default_book"] = journal.binary_default;
+        json["shelf"] = {
+            { "enabled", journal.shelf.enabled },
+            { "window", journal.shelf.window },
+            { "budget", journal.shelf.budget }
+        };
+        json["history_budget"] = journal.history_budget;
+        json["texture_budget"] = journal.texture_budget;
         json["background"]["file"] = journal.background_file;
         save_font (json, journal.text_font);
         save_font (json, journal.chapter_font);
         save_font (json, journal.button_font);
         save_font (json, journal.default_font);
 
-        std::ofstream of (settings_location);
-        if (!of.is_open ())
+        start_saving ([dump = json.dump (4)]
         {
-            log () << "Unable to open " << settings_location << " for writting." << std::endl;
-            return false;
-        }
-
-        of << json.dump (4);
+            std::ofstream of (settings_location);
+            if (!of.is_open ())
+                throw std::runtime_error ("Unable to open " + settings_location + " for writting");
+            of << dump;
+            of.close ();
+            if (!of)
+                throw std::runtime_error ("Writing " + settings_location + " failed");
+        },
+        [] (bool ok) { return ok; });
     }
     catch (std::exception const& ex)
     {
@@ -362,14 +1501,14 @@ load_settings ()
     {
         nlohmann::json json;
 
-        std::ifstream fi (settings_location);
-        if (!fi.is_open ())
+        if (!std::filesystem::exists (settings_location))
         {
             log () << "Unable to open " << settings_location << " for reading." << std::endl;
         }
         else
         {
-            fi >> json;
+            mapped_file file (settings_location);
+            json = nlohmann::json::parse (file.begin (), file.end ());
             if (json["version"]["major"].get<int> () != maj)
             {
                 log () << "Incompatible settings file." << std::endl;
@@ -427,6 +1566,19 @@ load_settings ()
             journal.background_file = json["background"].value ("file", journal.background_file);
 
         journal.show_titlebar = json.value ("titlebar", false);
+        journal.compact_books = json.value ("compact_books", false);
+        journal.binary_default = json.value ("binary_default_book", false);
+        select_default_book ();
+        journal.history_budget = json.value ("history_budget", 32);
+        journal.texture_budget = json.value ("texture_budget", 128);
+        journal.shelf = { false, 8, 64 };
+        if (json.contains ("shelf"))
+        {
+            auto const& shelf = json["shelf"];
+            journal.shelf.enabled = shelf.value ("enabled", journal.shelf.enabled);
+            journal.shelf.window = shelf.value ("window", journal.shelf.window);
+            journal.shelf.budget = shelf.value ("budget", journal.shelf.budget);
+        }
     }
     catch (std::exception const& ex)
     {
@@ -441,39 +1593,26 @@ load_settings ()
 bool
 load_takenotes (std::string const& source)
 {
+    finish_saving (true);
+    log_edits ();
     try
     {
-        std::ifstream fi (source);
-        if (!fi.is_open ())
+        mapped_file file (source);
+        std::string copy;
+        rapidxml::xml_document<> doc;
+        auto nodes = takenotes_pages (file, copy, doc);
+        auto n = nodes.size ();
+
+        auto texts = std::make_unique<text_store_t> (file.size (), journal.shelf.enabled);
+        page_list_t pages;
+        for (std::size_t i = 0; i < n; ++i)
+            pages.emplace_back (texts->resource);
+        for (std::size_t i = 0; i < n; ++i)
         {
-            log () << "Unable to open " << source << " for reading." << std::endl;
-            return false;
-        }
-
-        std::string content {std::istreambuf_iterator<char> (fi),
-                             std::istreambuf_iterator<char> ()};
-
-        using namespace rapidxml;
-        xml_document<> doc;
-        doc.parse<0> (&content[0]);
-        auto fiss = doc.first_node ("fiss");
-        if (!fiss) throw std::runtime_error ("No /fiss node");
-        auto data = fiss->first_node ("Data");
-        if (!data) throw std::runtime_error ("No /fiss/Data node");
-        auto noe = data->first_node ("NumberOfEntries");
-        if (!noe) throw std::runtime_error ("No /fiss/Data/NumberOfEntries node");
-        auto n = (int) std::stoul (noe->value ());
-
-        std::vector<page_t> pages (std::max (n, 2));
-        for (int i = 0; i < n; ++i)
-        {
-            auto num = std::to_string (i+1);
-            auto title = data->first_node (("date" + num).c_str ());
-            if (!title) continue; // Turns out there can be holes
-            auto entry = data->first_node (("entry" + num).c_str ());
-            if (!entry) continue;
-            pages[i].title = title->value ();
-            pages[i].content = entry->value ();
+            auto [title, entry] = nodes[i];
+            if (!title || !entry) continue; // Turns out there can be holes
+            pages[i].title.assign (title->value (), title->value_size ());
+            pages[i].content.assign (entry->value (), entry->value_size ());
         }
 
         while (pages.size () < 2)
@@ -482,14 +1621,80 @@ load_takenotes (std::string const& source)
             pages.emplace_back (page_t {});
         }
 
+        release_book ();
         journal.pages = std::move (pages);
+        journal.texts = std::move (texts);
         journal.current_page = 0;
+        forget_binary_book ();
     }
     catch (std::exception const& ex)
     {
         log () << "Unable to load Take Notes XML file: " << ex.what () << std::endl;
         return false;
     }
+    log_loaded (source);
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Visits the pages of a book file in the order they would have once loaded, without loading it.
+ *
+ * Safe on any thread, as it touches nothing of the journal. The texts live only until the whole
+ * book is visited. Throws on unreadable files, false if the book is of another version.
+ */
+
+bool
+read_book_pages (std::string const& source,
+        std::function<void (std::size_t, std::string_view, std::string_view)> const& visit)
+{
+    if (has_extension (source, ".xml"))
+    {
+        mapped_file file (source);
+        std::string copy;
+        rapidxml::xml_document<> doc;
+        auto nodes = takenotes_pages (file, copy, doc);
+        for (std::size_t i = 0; i < nodes.size (); ++i)
+            if (auto [title, entry] = nodes[i]; title && entry)
+                visit (i, { title->value (), title->value_size () },
+                        { entry->value (), entry->value_size () });
+        return true;
+    }
+
+    if (has_extension (source, ".jbook") || has_extension (source, ".jbz"))
+    {
+        std::ifstream fi (source, std::ios::binary);
+        if (!fi.is_open ())
+            throw std::runtime_error ("Unable to open " + source);
+        binary_header_t header;
+        if (!read_binary_header (fi, header))
+            return false;
+        std::vector<std::pair<std::uint64_t, std::string>> index (header.count);
+        for (auto& [record, title]: index)
+        {
+            record = read_pod<std::uint64_t> (fi);
+            read_text (fi, title);
+        }
+        page_t page;
+        std::string file;
+        for (std::size_t i = 0; i < index.size (); ++i)
+        {
+            read_record (fi, index[i].first, header.flags & binary_packed, page, file);
+            visit (i, index[i].second, page.content);
+        }
+        return true;
+    }
+
+    int maj;
+    journal_version (&maj, nullptr, nullptr, nullptr);
+    mapped_file file (source);
+    std::pmr::monotonic_buffer_resource texts (file.size ());
+    json_book_sax<page_t> sax (&texts);
+    if (!parse_json_book (file, book_format (source), maj, sax))
+        return false;
+    for (std::size_t i = 0; i < sax.pages.size (); ++i)
+        visit (i, sax.pages[i].page.title, sax.pages[i].page.content);
     return true;
 }
 
@@ -534,11 +1739,13 @@ load_variables ()
     {
         nlohmann::json json;
 
-        std::ifstream fi (variables_location);
-        if (!fi.is_open ())
+        if (!std::filesystem::exists (variables_location))
             log () << "Unable to open " << variables_location << " for reading." << std::endl;
         else
-            fi >> json;
+        {
+            mapped_file file (variables_location);
+            json = nlohmann::json::parse (file.begin (), file.end ());
+        }
 
         // It is a bit more complex as at least the order of custom elements is to be preserved.
         journal.variables.erase (std::remove_if (
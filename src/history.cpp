@@ -0,0 +1,620 @@
+/**
+ * @file history.cpp
+ * @brief Undo and redo of the book edits, within a memory budget
+ * @internal
+ *
+ * This file is part of Skyrim SE Journal mod (aka Journal).
+ *
+ *   Journal is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Journal is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Journal. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Core
+ *
+ * @details
+ * The edits made during a frame form one step: a typing session in a text widget, a word wrap of
+ * the whole book, a deleted chapter and so on. A step keeps only what was changed, never copies of
+ * the pages. The texts are stored as hunks: u32 offset in the older text, u32 older size, u32 newer
+ * size, the older and the newer bytes. Hunks of the same size (as these of the word wrap) are
+ * patched in place. The inserted or erased pages are moved out of the book into the step, while
+ * these are not in the book.
+ *
+ * The steps refer to the pages by their index, which is right as long as every change to the page
+ * order goes through insert_pages () and erase_pages (). Once the steps take more than the budget,
+ * the oldest go first.
+ */
+
+#include "sse-journal.hpp"
+#include <algorithm>
+#include <iterator>
+#include <deque>
+#include <cstring>
+
+//--------------------------------------------------------------------------------------------------
+
+namespace {
+
+enum : std::uint8_t { op_content, op_title, op_image, op_insert, op_erase };
+
+/// Equal bytes between two differing runs, below which these go in one hunk (less than a header)
+constexpr std::size_t merge_gap = 6;
+
+struct change_t
+{
+    std::uint8_t op;
+    std::uint32_t at;           ///< Page index, the first one for inserts and erases
+    std::uint32_t count;        ///< Of the inserted or erased pages
+    std::string diff;           ///< Text hunks, or the older and newer image
+    std::vector<page_t> pages;  ///< Inserted or erased ones, while out of the book
+};
+
+struct step_t
+{
+    std::vector<change_t> changes;
+    std::size_t bytes = 0;
+    unsigned before, after;     ///< Current page
+};
+
+struct history_t
+{
+    std::deque<step_t> steps;
+    std::size_t applied = 0;    ///< Steps done, the ones after are undone
+    std::size_t bytes = 0;
+    bool open = false;          ///< The last step still gathers the changes of this frame
+    bool typing = false;
+    std::string typed;          ///< Text before the edits of the active widget
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> positions; ///< Page ids and indices, by id
+    std::uint64_t version = ~std::uint64_t (0);     ///< Of the pages order, for the positions
+};
+
+/**
+ * Built on the first edit, long after the journal, so it is destroyed before the journal.
+ *
+ * The moved out pages may still hold texts of journal.texts, which must be there when these are
+ * freed. As a plain global the order against the journal, defined elsewhere, would be unspecified.
+ */
+
+history_t&
+edit_history ()
+{
+    static history_t history;
+    return history;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+template<class T>
+void
+put (std::string& out, T const& v)
+{
+    out.append (reinterpret_cast<const char*> (&v), sizeof (T));
+}
+
+template<class T>
+T
+get (const char*& p)
+{
+    T v;
+    std::memcpy (&v, p, sizeof (T));
+    p += sizeof (T);
+    return v;
+}
+
+void
+hunk (std::string& out, std::size_t offset, std::string_view older, std::string_view newer)
+{
+    put (out, std::uint32_t (offset));
+    put (out, std::uint32_t (older.size ()));
+    put (out, std::uint32_t (newer.size ()));
+    out.append (older).append (newer);
+}
+
+/// The hunks turning @p a into @p b, equally sized middles are split into their differing runs
+std::string
+diff (std::string_view a, std::string_view b)
+{
+    std::size_t n = std::min (a.size (), b.size ()), prefix = 0, suffix = 0;
+    while (prefix < n && a[prefix] == b[prefix])
+        ++prefix;
+    while (suffix < n - prefix && a[a.size () - 1 - suffix] == b[b.size () - 1 - suffix])
+        ++suffix;
+    a = a.substr (prefix, a.size () - prefix - suffix);
+    b = b.substr (prefix, b.size () - prefix - suffix);
+
+    std::string out;
+    if (a.size () != b.size ())
+        hunk (out, prefix, a, b);
+    else for (std::size_t i = 0; i < a.size (); )
+    {
+        if (a[i] == b[i])
+        {
+            ++i;
+            continue;
+        }
+        auto last = i;
+        for (auto j = i + 1; j < a.size () && j - last <= merge_gap; ++j)
+            if (a[j] != b[j])
+                last = j;
+        hunk (out, prefix + i, a.substr (i, last + 1 - i), b.substr (i, last + 1 - i));
+        i = last + 1;
+    }
+    return out;
+}
+
+template<class Fn>
+void
+for_each_hunk (std::string_view diff, Fn&& fn)
+{
+    for (auto p = diff.data (), end = p + diff.size (); p != end; )
+    {
+        auto offset = get<std::uint32_t> (p);
+        auto older = get<std::uint32_t> (p);
+        auto newer = get<std::uint32_t> (p);
+        fn (std::size_t (offset), std::string_view (p, older), std::string_view (p + older, newer));
+        p += older + newer;
+    }
+}
+
+/// Applies the hunks forward (older to newer) or back, with a single pass over the text at most
+void
+patch (text_t& text, std::string_view diff, bool forward)
+{
+    std::size_t hunks = 0;
+    bool sized = true;
+    for_each_hunk (diff, [&] (auto, auto older, auto newer) {
+        ++hunks;
+        sized = sized && older.size () == newer.size ();
+    });
+
+    if (sized)
+    {
+        for_each_hunk (diff, [&] (auto offset, auto older, auto newer) {
+            auto s = forward ? newer : older;
+            std::memcpy (text.data () + offset, s.data (), s.size ());
+        });
+    }
+    else if (hunks == 1)
+    {
+        for_each_hunk (diff, [&] (auto offset, auto older, auto newer) {
+            if (forward) text.replace (offset, older.size (), newer);
+            else text.replace (offset, newer.size (), older);
+        });
+    }
+    else
+    {
+        std::string out;
+        std::string_view src = text;
+        std::size_t pos = 0, delta = 0;
+        for_each_hunk (diff, [&] (auto offset, auto older, auto newer) {
+            auto at = forward ? offset : offset + delta;
+            out.append (src.substr (pos, at - pos)).append (forward ? newer : older);
+            pos = at + (forward ? older : newer).size ();
+            delta += newer.size () - older.size ();
+        });
+        out.append (src.substr (pos));
+        text.assign (out);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void
+put_image (std::string& out, image_t const& img)
+{
+    put (out, std::uint32_t (img.file.size ()));
+    out.append (img.file);
+    put (out, std::uint8_t (img.background));
+    put (out, img.tint);
+    put (out, img.uv);
+    put (out, img.xy);
+}
+
+/// Restores the image, or just skips over it without @p img
+void
+get_image (const char*& p, image_t* img)
+{
+    auto n = get<std::uint32_t> (p);
+    std::string file (p, n);
+    p += n;
+    auto background = get<std::uint8_t> (p);
+    auto tint = get<std::uint32_t> (p);
+    auto uv = get<decltype (img->uv)> (p);
+    auto xy = get<decltype (img->xy)> (p);
+    if (!img)
+        return;
+    assign_image (file, *img);
+    img->background = background;
+    img->tint = tint;
+    img->uv = uv;
+    img->xy = xy;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+std::size_t
+step_bytes (step_t const& step)
+{
+    std::size_t n = sizeof (step_t);
+    for (auto const& c: step.changes)
+    {
+        n += sizeof (change_t) + c.diff.capacity ();
+        for (auto const& p: c.pages)
+            n += sizeof (page_t) + p.title.capacity () + p.content.capacity ();
+    }
+    return n;
+}
+
+/// The pages held by the step are gone for good
+void
+discard (step_t& step)
+{
+    auto& history = edit_history ();
+    for (auto& c: step.changes)
+        for (auto& p: c.pages)
+            release_image (p.image);
+    history.bytes -= step.bytes;
+}
+
+void
+move_out (change_t& c)
+{
+    auto first = journal.pages.begin () + c.at;
+    for (auto it = first; it != first + c.count; ++it)
+    {
+        // The binary book records may be rewritten by the saves until the pages are back. The
+        // unreadable pages keep theirs, until the book is rewritten (@see drop_erased_records).
+        if (fetch_page (*it))
+        {
+            it->dirty = true;
+            it->record = 0;
+        }
+        release_image (it->image);
+        c.pages.push_back (std::move (*it));
+    }
+    journal.pages.erase (first, first + c.count);
+}
+
+void
+move_in (change_t& c)
+{
+    journal.pages.insert (journal.pages.begin () + c.at, std::make_move_iterator (c.pages.begin ()),
+                                                         std::make_move_iterator (c.pages.end ()));
+    c.pages.clear ();
+}
+
+void
+replay (change_t& c, bool forward)
+{
+    switch (c.op)
+    {
+        case op_content:
+        {
+            auto& p = journal.pages[c.at];
+            fetch_page (p);
+            patch (p.content, c.diff, forward);
+            touch_page (p);
+            break;
+        }
+        case op_title:
+        {
+            auto& p = journal.pages[c.at];
+            patch (p.title, c.diff, forward);
+            index_page (p);
+            touch_title (p);
+            break;
+        }
+        case op_image:
+        {
+            auto& p = journal.pages[c.at];
+            fetch_page (p);
+            const char* r = c.diff.data ();
+            if (forward) get_image (r, nullptr);
+            get_image (r, &p.image);
+            touch_page (p);
+            break;
+        }
+        case op_insert:
+        case op_erase:
+            if ((c.op == op_insert) == forward) move_in (c);
+            else move_out (c);
+            break;
+    }
+}
+
+/// Drops the oldest steps while over the budget
+void
+trim ()
+{
+    auto& history = edit_history ();
+    std::size_t budget = std::size_t (std::max (journal.history_budget, 0)) << 20;
+    while (history.bytes > budget && history.applied)
+    {
+        discard (history.steps.front ());
+        history.steps.pop_front ();
+        history.applied--;
+    }
+}
+
+/// The changes go into the step of this frame, which replaces the undone ones
+change_t&
+change (std::uint8_t op, std::size_t at)
+{
+    auto& history = edit_history ();
+    if (!history.open)
+    {
+        while (history.steps.size () > history.applied)
+        {
+            discard (history.steps.back ());
+            history.steps.pop_back ();
+        }
+        history.steps.emplace_back ().before = journal.current_page;
+        history.applied++;
+        history.open = true;
+    }
+    return history.steps.back ().changes.emplace_back (change_t { op, std::uint32_t (at), 0, {}, {} });
+}
+
+/// Through the page ids table, taken again only once the page order changes
+std::size_t
+index_of (page_t const& page)
+{
+    auto& history = edit_history ();
+    auto& positions = history.positions;
+    if (history.version != journal.pages.version ())
+    {
+        history.version = journal.pages.version ();
+        positions.clear ();
+        std::uint32_t i = 0;
+        for (auto const& p: journal.pages)
+            positions.emplace_back (p.id, i++);
+        std::sort (positions.begin (), positions.end ());
+    }
+    auto it = std::lower_bound (positions.begin (), positions.end (),
+            std::pair (page.id, std::uint32_t (0)));
+    return it != positions.end () && it->first == page.id ? it->second : journal.pages.size ();
+}
+
+/// Same image change of the same page as in the last step, like when dragging its sliders
+change_t*
+last_image_change (std::size_t at)
+{
+    auto& history = edit_history ();
+    if (history.open || !history.applied || history.applied != history.steps.size ())
+        return nullptr;
+    auto& changes = history.steps.back ().changes;
+    if (changes.size () != 1 || changes[0].op != op_image || changes[0].at != at)
+        return nullptr;
+    return &changes[0];
+}
+
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void
+edit_content (page_t& page, std::string_view content)
+{
+    if (!fetch_page (page))
+        return;
+    auto d = diff (page.content, content);
+    if (d.empty ())
+        return;
+    change (op_content, index_of (page)).diff = std::move (d);
+    page.content = content;
+    touch_page (page);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void
+replace_content (page_t& page, std::size_t pos, std::size_t n, std::string_view s)
+{
+    if (!fetch_page (page))
+        return;
+    pos = std::min (pos, page.content.size ());
+    auto older = page.content.view ().substr (pos, n);
+    if (older == s)
+        return;
+    hunk (change (op_content, index_of (page)).diff, pos, older, s);
+    page.content.replace (pos, n, s);
+    touch_page (page);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void
+typing_started (std::string_view text)
+{
+    auto& history = edit_history ();
+    history.typed = text;
+    history.typing = true;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void
+typing_ended (page_t& page, text_t const& text)
+{
+    auto& history = edit_history ();
+    if (!history.typing)
+        return;
+    history.typing = false;
+    auto d = diff (history.typed, text);
+    std::string ().swap (history.typed);
+    if (!d.empty ())
+        change (&text == &page.title ? op_title : op_content, index_of (page)).diff = std::move (d);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void
+image_edited (page_t const& page, image_t const& before)
+{
+    auto& history = edit_history ();
+    auto at = index_of (page);
+    auto c = last_image_change (at);
+    if (c)
+    {
+        // Reopen the last step and keep its older image only
+        const char* r = c->diff.data ();
+        get_image (r, nullptr);
+        c->diff.resize (r - c->diff.data ());
+        history.open = true;
+    }
+    else
+    {
+        c = &change (op_image, at);
+        put_image (c->diff, before);
+    }
+    put_image (c->diff, page.image);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void
+insert_pages (std::size_t at, std::size_t n)
+{
+    for (std::size_t i = 0; i < n; ++i)
+        journal.pages.insert (journal.pages.begin () + at, page_t {});
+    change (op_insert, at).count = std::uint32_t (n);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void
+erase_pages (std::size_t at, std::size_t n)
+{
+    auto& c = change (op_erase, at);
+    c.count = std::uint32_t (n);
+    move_out (c);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// Call once a frame, after all the edits are done
+void
+end_edit_step ()
+{
+    auto& history = edit_history ();
+    if (!history.open)
+        return;
+    history.open = false;
+    auto& step = history.steps.back ();
+    step.after = journal.current_page;
+    history.bytes -= step.bytes;
+    step.bytes = step_bytes (step);
+    history.bytes += step.bytes;
+    trim ();
+    if (!history.applied)
+        log () << "Undo history budget is too small for the last edit." << std::endl;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static void
+redo_step (bool forward)
+{
+    auto& history = edit_history ();
+    auto& step = history.steps[forward ? history.applied++ : --history.applied];
+    if (forward)
+        for (auto& c: step.changes) replay (c, true);
+    else
+        for (auto it = step.changes.rbegin (); it != step.changes.rend (); ++it) replay (*it, false);
+
+    // The pages moved between the book and the step
+    history.bytes -= step.bytes;
+    step.bytes = step_bytes (step);
+    history.bytes += step.bytes;
+
+    journal.current_page = std::min (forward ? step.after : step.before,
+                                     unsigned (journal.pages.size () - 2));
+    trim ();
+}
+
+bool
+undo_edits ()
+{
+    auto& history = edit_history ();
+    end_edit_step ();
+    history.typing = false;
+    if (!history.applied)
+        return false;
+    redo_step (false);
+    return true;
+}
+
+bool
+redo_edits ()
+{
+    auto& history = edit_history ();
+    end_edit_step ();
+    history.typing = false;
+    if (history.applied == history.steps.size ())
+        return false;
+    redo_step (true);
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// Before the book is replaced, as the held pages may be allocated from its text store
+void
+forget_edits ()
+{
+    auto& history = edit_history ();
+    for (auto& step: history.steps)
+        discard (step);
+    history.steps.clear ();
+    history.applied = 0;
+    history.bytes = 0;
+    history.open = false;
+    history.typing = false;
+    std::string ().swap (history.typed);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// The binary book was rewritten without the erased pages, so these which could not be read are
+/// gone for good, and can come back only empty
+void
+drop_erased_records ()
+{
+    auto& history = edit_history ();
+    std::size_t lost = 0;
+    for (auto& step: history.steps)
+        for (auto& c: step.changes)
+            for (auto& p: c.pages)
+                if (p.broken)
+                {
+                    p.broken = false;
+                    p.loaded = true;
+                    p.dirty = true;
+                    p.record = 0;
+                    ++lost;
+                }
+    if (lost)
+        log () << "The content of " << lost << " erased unreadable pages is lost" << std::endl;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+history_stats_t
+history_stats ()
+{
+    auto& history = edit_history ();
+    return { history.applied, history.steps.size () - history.applied, history.bytes };
+}
+
+//--------------------------------------------------------------------------------------------------
+
@@ -0,0 +1,200 @@
+/**
+ * @file pageindex.cpp
+ * @brief Compact metadata of the book pages, for the passes over the whole book
+ * @internal
+ *
+ * This file is part of Skyrim SE Journal mod (aka Journal).
+ *
+ *   Journal is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Journal is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Journal. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Core
+ *
+ * @details
+ * The index is brought up to date lazily, when asked for. A change in the page order (as told by
+ * the page list version) rebuilds the arrays, reusing the entries of the pages still there. The
+ * edited pages are marked through index_page () and only their entries are refreshed.
+ */
+
+#include "sse-journal.hpp"
+#include <utils/utf8.hpp>
+#include <algorithm>
+#include <unordered_map>
+
+//--------------------------------------------------------------------------------------------------
+
+namespace {
+
+struct
+{
+    page_index_t index;
+    std::uint64_t version = ~std::uint64_t (0);     ///< Of the page list the index is built for
+    std::vector<std::uint32_t> stale;               ///< Ids of the pages to refresh
+    std::size_t garbage = 0;                        ///< Bytes of replaced titles in the blob
+}
+state;
+
+//--------------------------------------------------------------------------------------------------
+
+/// Titles which fit in the place of the old one stay there, the rest go at the end of the blob
+void
+store_title (std::size_t i, std::string_view title)
+{
+    auto& ndx = state.index;
+    if (title.size () <= ndx.title_size[i])
+    {
+        state.garbage += ndx.title_size[i] - title.size ();
+        std::copy (title.begin (), title.end (), ndx.titles.begin () + ndx.title_offset[i]);
+        ndx.titles[ndx.title_offset[i] + title.size ()] = '\0';
+    }
+    else
+    {
+        state.garbage += ndx.title_size[i] + 1;
+        ndx.title_offset[i] = std::uint32_t (ndx.titles.size ());
+        ndx.titles.append (title).push_back ('\0');
+    }
+    ndx.title_size[i] = std::uint32_t (title.size ());
+}
+
+void
+fill (std::size_t i, page_t const& p)
+{
+    auto& ndx = state.index;
+    store_title (i, p.title);
+    std::uint8_t flags = visible_symbols (p.title) ? page_index_t::visible_title : 0;
+    if (p.loaded)
+    {
+        flags |= page_index_t::fetched;
+        if (visible_symbols (p.content)) flags |= page_index_t::visible_content;
+        if (!p.image.file.empty ()) flags |= page_index_t::has_image;
+        ndx.content_size[i] = std::uint32_t (p.content.size ());
+        ndx.hash[i] = std::hash<std::string_view> {} (p.content);
+    }
+    else
+    {
+        ndx.content_size[i] = 0;
+        ndx.hash[i] = 0;
+    }
+    ndx.flags[i] = flags;
+}
+
+/// New arrays in the current page order, the known pages keep their entries
+void
+rebuild ()
+{
+    auto& ndx = state.index;
+    std::unordered_map<std::uint32_t, std::size_t> known;
+    known.reserve (ndx.size ());
+    for (std::size_t i = 0; i < ndx.size (); ++i)
+        known.emplace (ndx.ids[i], i);
+
+    page_index_t out;
+    auto n = journal.pages.size ();
+    out.ids.resize (n);
+    out.title_offset.resize (n);
+    out.title_size.resize (n);
+    out.content_size.resize (n);
+    out.flags.resize (n);
+    out.hash.resize (n);
+    out.titles.reserve (ndx.titles.size () - state.garbage);
+
+    std::vector<std::size_t> fresh;
+    std::size_t i = 0;
+    for (auto const& p: journal.pages)
+    {
+        out.ids[i] = p.id;
+        out.title_offset[i] = std::uint32_t (out.titles.size ());
+        auto it = known.find (p.id);
+        if (it != known.end ())
+        {
+            auto k = it->second;
+            out.title_size[i] = ndx.title_size[k];
+            out.titles.append (ndx.title (k), ndx.title_size[k] + 1);
+            out.content_size[i] = ndx.content_size[k];
+            out.flags[i] = ndx.flags[k];
+            out.hash[i] = ndx.hash[k];
+        }
+        else
+        {
+            // Room for the title, so that fill () writes it in place
+            out.title_size[i] = std::uint32_t (p.title.size ());
+            out.titles.append (p.title).push_back ('\0');
+            fresh.push_back (i);
+        }
+        ++i;
+    }
+
+    ndx = std::move (out);
+    state.garbage = 0;
+    state.version = journal.pages.version ();
+    for (auto k: fresh)
+        fill (k, journal.pages[k]);
+}
+
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool
+visible_symbols (std::string_view s)
+{
+    for (std::size_t i = 0, n; i < s.size (); i += n)
+    {
+        char32_t c;
+        n = utf8_decode (s, i, c);
+        if (!is_space (c) && !is_control (c))
+            return true;
+    }
+    return false;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void
+index_page (page_t const& page)
+{
+    state.stale.push_back (page.id);
+    reindex_words (page);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+page_index_t const&
+page_index ()
+{
+    auto& stale = state.stale;
+    if (state.version != journal.pages.version ())
+        rebuild ();
+
+    if (!stale.empty ())
+    {
+        std::sort (stale.begin (), stale.end ());
+        stale.erase (std::unique (stale.begin (), stale.end ()), stale.end ());
+        auto const& ids = state.index.ids;
+        for (std::size_t i = 0; i < ids.size (); ++i)
+            if (std::binary_search (stale.begin (), stale.end (), ids[i]))
+                fill (i, journal.pages[i]);
+        stale.clear ();
+    }
+
+    // Edited titles leave holes behind, compact once these are most of the blob
+    if (state.garbage > 4096 && state.garbage > state.index.titles.size () / 2)
+        rebuild ();
+
+    return state.index;
+}
+
+//--------------------------------------------------------------------------------------------------
+
@@ -0,0 +1,292 @@
+/**
+ * @file pagesearch.cpp
+ * @brief Search of the book pages, spread over the frames
+ * @internal
+ *
+ * This file is part of Skyrim SE Journal mod (aka Journal).
+ *
+ *   Journal is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Journal is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Journal. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Core
+ *
+ * @details
+ * The search walks the pages in the book order, a bounded time each frame, so the results come
+ * in while the query is still typed. The pages which are not in memory are fetched (or unshelved)
+ * as the walk reaches them. A changed query, or pages inserted or erased, start the walk over. The
+ * edits of the already searched pages are not followed, their matches are as of the walk.
+ *
+ * The library search reads the book files of the books directory instead, on a worker per core.
+ * Each worker takes the next book, reads it whole, searches it, and drops it before taking
+ * another, so the memory is bounded by the largest books rather than the whole library. The
+ * matches are handed over to the render thread book by book.
+ */
+
+#include "sse-journal.hpp"
+#include <utils/search.hpp>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <thread>
+
+//--------------------------------------------------------------------------------------------------
+
+namespace {
+
+/// Search time per frame, at least one page is done anyway
+constexpr auto frame_work = std::chrono::microseconds (2000);
+
+/// The rest are only counted, no one reads through that many
+constexpr std::size_t max_hits = 1000;
+
+/// Bytes of text around the match in the snippets
+constexpr std::size_t before = 24, after = 56;
+
+struct
+{
+    search_state_t state;
+    std::size_t next;           ///< Page to search
+    std::uint64_t version;      ///< Of the page list
+}
+search;
+
+/// The match and the text around it on one line, cut on UTF-8 sequence boundaries
+std::string
+snippet (std::string_view text, std::size_t at, std::size_t n)
+{
+    auto b = at - std::min (at, before);
+    auto e = std::min (text.size (), at + n + after);
+    while (b < at && (text[b] & 0xc0) == 0x80) ++b;
+    while (e > at + n && e < text.size () && (text[e] & 0xc0) == 0x80) --e;
+
+    std::string s;
+    if (b) s = "...";
+    for (auto c: text.substr (b, e - b))
+        s += (c == '\n' || c == '\r' || c == '\t') ? ' ' : c;
+    if (e < text.size ()) s += "...";
+    return s;
+}
+
+/// Calls @p hit for each match in @p text
+template<class Function>
+void
+find_all (std::string_view text, std::string_view query, bool match_case, Function&& hit)
+{
+    auto find = match_case ? find_text : find_text_nocase;
+    for (auto at = find (text, query, 0); at != std::string_view::npos;
+            at = find (text, query, at + query.size ()))
+        hit (at);
+}
+
+void
+find_all (std::size_t page, std::string_view text, bool title)
+{
+    auto& st = search.state;
+    find_all (text, st.query, st.match_case, [&] (std::size_t at) {
+        if (st.hits.size () < max_hits)
+            st.hits.push_back ({ page, title, snippet (text, at, st.query.size ()) });
+        ++st.matches;
+    });
+}
+
+/// Shared by the workers, but owned by the render thread, which waits on them before destruction
+struct library_job_t
+{
+    std::string query;
+    bool match_case;
+    std::vector<std::string> books;
+
+    std::atomic<std::size_t> next = 0, searched = 0;
+    std::atomic<bool> cancel = false;
+    std::vector<std::future<void>> workers;
+
+    std::mutex mutex;               ///< Over the rest
+    std::vector<library_hit_t> hits;///< Not yet taken by the render thread
+    std::vector<std::string> errors;///< For the log, which is of the render thread
+    std::size_t matches = 0, listed = 0;
+
+    /// The members go only once the workers are done with them
+    ~library_job_t ()
+    {
+        cancel = true;
+        for (auto& w: workers)
+            w.wait ();
+    }
+};
+
+struct
+{
+    library_state_t state;
+    std::unique_ptr<library_job_t> job;
+    std::vector<std::unique_ptr<library_job_t>> cancelled;  ///< Until their workers are done
+}
+library;
+
+void
+search_books (library_job_t& job)
+{
+    for (std::size_t i; !job.cancel && (i = job.next++) < job.books.size (); ++job.searched)
+    {
+        auto const& book = job.books[i];
+        std::vector<library_hit_t> hits;
+        std::size_t matches = 0;
+        try
+        {
+            auto ok = read_book_pages (book, [&] (std::size_t page, std::string_view title,
+                                                  std::string_view content) {
+                for (auto [text, is_title]: { std::pair (title, true), std::pair (content, false) })
+                    find_all (text, job.query, job.match_case, [&] (std::size_t at) {
+                        if (hits.size () < max_hits)
+                            hits.push_back ({ book, page, is_title,
+                                              snippet (text, at, job.query.size ()) });
+                        ++matches;
+                    });
+            });
+            if (!ok)
+                continue; // Another version, it can not be loaded either
+        }
+        catch (std::exception const& ex)
+        {
+            std::lock_guard<std::mutex> lock (job.mutex);
+            job.errors.push_back ("Unable to search " + book + ": " + ex.what ());
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock (job.mutex);
+        job.matches += matches;
+        hits.erase (hits.begin () + std::min (hits.size (), max_hits - job.listed), hits.end ());
+        job.listed += hits.size ();
+        job.hits.insert (job.hits.end (),
+                std::make_move_iterator (hits.begin ()), std::make_move_iterator (hits.end ()));
+    }
+}
+
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void
+search_pages (std::string_view query, bool match_case)
+{
+    if (query == search.state.query && match_case == search.state.match_case)
+        return;
+    search.state.query = query;
+    search.state.match_case = match_case;
+    search.version = ~std::uint64_t (0);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+search_state_t const&
+continue_search ()
+{
+    auto& st = search.state;
+    if (search.version != journal.pages.version ())
+    {
+        search.version = journal.pages.version ();
+        search.next = 0;
+        st.hits.clear ();
+        st.matches = 0;
+    }
+    st.pages = journal.pages.size ();
+    if (st.query.empty ())
+        search.next = st.pages;
+
+    auto deadline = std::chrono::steady_clock::now () + frame_work;
+    while (search.next < st.pages)
+    {
+        auto i = search.next++;
+        auto& page = journal.pages[i];
+        find_all (i, page.title, true);
+        if (fetch_page (page) && page.content.size () >= st.query.size ())
+            find_all (i, page.content, false);
+        if (std::chrono::steady_clock::now () > deadline)
+            break;
+    }
+    st.searched = search.next;
+    return st;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void
+search_library (std::string_view query, bool match_case, bool again)
+{
+    auto& st = library.state;
+    if (!again && library.job && query == st.query && match_case == st.match_case)
+        return;
+    if (library.job)
+    {
+        library.job->cancel = true;
+        library.cancelled.push_back (std::move (library.job));
+    }
+
+    st.query = query;
+    st.match_case = match_case;
+    st.hits.clear ();
+    st.matches = st.searched = st.books = 0;
+    if (query.empty ())
+        return;
+
+    extern void enumerate_filenames (std::string const& wildcard, std::vector<std::string>& out);
+    auto job = std::make_unique<library_job_t> ();
+    job->query = query;
+    job->match_case = match_case;
+    for (auto ext: { ".json", ".xml", ".jbook", ".jbz", ".cbor", ".msgpack" })
+    {
+        std::vector<std::string> names;
+        enumerate_filenames (books_directory + "*" + ext, names);
+        for (auto& name: names)
+            job->books.push_back (books_directory + name + ext);
+    }
+    st.books = job->books.size ();
+
+    auto workers = std::min<std::size_t> (st.books, std::max (1u, std::thread::hardware_concurrency ()));
+    for (std::size_t i = 0; i < workers; ++i)
+        job->workers.push_back (std::async (std::launch::async, search_books, std::ref (*job)));
+    library.job = std::move (job);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+library_state_t const&
+continue_library_search ()
+{
+    auto done = [] (auto const& job) {
+        return std::all_of (job->workers.begin (), job->workers.end (), [] (auto const& w) {
+            return w.wait_for (std::chrono::seconds (0)) == std::future_status::ready;
+        });
+    };
+    auto& cancelled = library.cancelled;
+    cancelled.erase (std::remove_if (cancelled.begin (), cancelled.end (), done), cancelled.end ());
+
+    auto& st = library.state;
+    if (auto& job = library.job)
+    {
+        std::lock_guard<std::mutex> lock (job->mutex);
+        st.hits.insert (st.hits.end (), std::make_move_iterator (job->hits.begin ()),
+                std::make_move_iterator (job->hits.end ()));
+        job->hits.clear ();
+        for (auto const& e: job->errors)
+            log () << e << std::endl;
+        job->errors.clear ();
+        st.matches = job->matches;
+        st.searched = job->searched;
+    }
+    return st;
+}
+
+//--------------------------------------------------------------------------------------------------
+
@@ -26,7 +26,8 @@
  */
 
 #include "sse-journal.hpp"
-#include <cctype>
+#include <utils/search.hpp>
+#include <utils/utf8.hpp>
 #include <cstring>
 #include <gsl/gsl_util>
 
@@ -104,12 +105,14 @@ bool setup() {
 
   auto &j = journal;
   j.button_prev.init("Prev##B", 0.f, 0, .050f, 1.f, lite_tint);
-  j.button_settings.init("Settings##B", .070f, 0, .128f, .060f, dark_tint, .5f,
-                         .85f);
-  j.button_elements.init("Elements##B", .212f, 0, .128f, .060f, dark_tint, .5f,
-                         .85f);
-  j.button_chapters.init("Chapters##B", .354f, 0, .128f, .060f, dark_tint, .5f,
-                         .85f);
+  j.button_settings.init("Settings##B", .070f, 0, .0955f, .060f, dark_tint,
+                         .5f, .85f);
+  j.button_elements.init("Elements##B", .1755f, 0, .0955f, .060f, dark_tint,
+                         .5f, .85f);
+  j.button_chapters.init("Chapters##B", .281f, 0, .0955f, .060f, dark_tint,
+                         .5f, .85f);
+  j.button_search.init("Search##B", .3865f, 0, .0955f, .060f, dark_tint, .5f,
+                       .85f);
   j.button_save.init("Save##B", .528f, 0, .128f, .060f, dark_tint, .5f, .85f);
   j.button_saveas.init("Save As##B", .670f, 0, .128f, .060f, dark_tint, .5f,
                        .85f);
@@ -121,66 +124,101 @@ bool setup() {
   // each one. Should be bearable in practice for lower spec machines. The ImGui
   // is well responsive btw.
 
-  load_book(default_book); // This one also may not exist
+  load_default_book(); // May not exist yet
   if (journal.pages.size() < 3)
     journal.pages.resize(2);
   if (journal.current_page + 2 >= journal.pages.size())
     journal.current_page = 0;
+  replay_edit_log(); // Edits since the last save, if the game went down
 
   return true;
 }
 
 //--------------------------------------------------------------------------------------------------
 
-/// Resizing one by one causes FPS stutters and CDTs, hence minimal SSO size +
-/// power of 2
-
-static inline std::size_t next_pow2(std::size_t n) {
-  std::size_t p = 16;
-  while (p < n)
-    p <<= 1;
-  return p;
-};
-
-static void append_input(std::string &text, std::string const &suffix) {
-  auto sz = std::strlen(text.c_str());
-  if (sz + suffix.size() > text.size())
-    text.resize(next_pow2(sz + suffix.size() + text.size()));
-  text.insert(sz, suffix);
+static void append_input(page_t &page, std::string const &suffix) {
+  replace_content(page, text_t::npos, 0, suffix);
 }
 
+/// ImGui edits in the spare capacity, the size always follows the text length,
+/// while the growth is left to the (geometric) std::string one
 static int imgui_text_resize(ImGuiInputTextCallbackData *data) {
   if (data->EventFlag == ImGuiInputTextFlags_CallbackResize) {
     auto str = reinterpret_cast<std::string *>(data->UserData);
-    str->resize(next_pow2(data->BufSize) -
-                1); // likely to avoid the internal pow2 of resize
-    data->Buf = const_cast<char *>(str->c_str());
+    str->resize(data->BufTextLen);
+    data->Buf = str->data();
+    data->BufSize = int(str->capacity() + 1);
   }
   return 0;
 }
 
-/// Shared
 bool imgui_input_text(const char *label, std::string &text,
                       ImGuiInputTextFlags flags = 0) {
-  return imgui.igInputText(
-      label, const_cast<char *>(text.c_str()), text.size() + 1,
-      flags | ImGuiInputTextFlags_CallbackResize, imgui_text_resize, &text);
+  return imgui.igInputText(label, text.data(), text.capacity() + 1,
+                           flags | ImGuiInputTextFlags_CallbackResize,
+                           imgui_text_resize, &text);
 }
 
-/// Shared
 bool imgui_input_multiline(const char *label, std::string &text,
                            ImVec2 const &size, ImGuiInputTextFlags flags = 0) {
   return imgui.igInputTextMultiline(
-      label, const_cast<char *>(text.c_str()), text.size() + 1, size,
+      label, text.data(), text.capacity() + 1, size,
       flags | ImGuiInputTextFlags_CallbackResize, imgui_text_resize, &text);
 }
 
+/// The edits report the new length, the resizes (also called on reverts) the
+/// needed capacity, so the page texts never scan for their NUL
+static int imgui_page_callback(ImGuiInputTextCallbackData *data) {
+  auto text = reinterpret_cast<text_t *>(data->UserData);
+  if (data->EventFlag == ImGuiInputTextFlags_CallbackResize) {
+    text->reserve(data->BufTextLen);
+    data->Buf = text->data();
+    data->BufSize = int(text->capacity() + 1);
+  }
+  if (data->EventFlag & (ImGuiInputTextFlags_CallbackResize |
+                         ImGuiInputTextFlags_CallbackEdit))
+    text->set_length(data->BufTextLen);
+  return 0;
+}
+
+/// A whole edit session of the last drawn page text widget is one undo step
+static void track_typing(page_t &page, text_t const &text) {
+  if (imgui.igIsItemActivated())
+    typing_started(text);
+  if (imgui.igIsItemDeactivatedAfterEdit())
+    typing_ended(page, text);
+}
+
+static constexpr ImGuiInputTextFlags page_flags =
+    ImGuiInputTextFlags_CallbackResize | ImGuiInputTextFlags_CallbackEdit;
+
+bool imgui_input_text(const char *label, text_t &text,
+                      ImGuiInputTextFlags flags = 0) {
+  return imgui.igInputText(label, text.data(), text.capacity() + 1,
+                           flags | page_flags, imgui_page_callback, &text);
+}
+
+bool imgui_input_multiline(const char *label, text_t &text, ImVec2 const &size,
+                           ImGuiInputTextFlags flags = 0) {
+  return imgui.igInputTextMultiline(label, text.data(), text.capacity() + 1,
+                                    size, flags | page_flags,
+                                    imgui_page_callback, &text);
+}
+
+/// The pages which could not be read from their book are shown, but not editable
+static ImGuiInputTextFlags content_flags(page_t const &page) {
+  return page.broken ? ImGuiInputTextFlags_ReadOnly : 0;
+}
+
 //--------------------------------------------------------------------------------------------------
 
-static void popup_error(bool begin, const char *name) {
+static void popup_error(bool begin, const char *name,
+                        const char *detail = nullptr) {
   if (begin && !imgui.igIsPopupOpen_Str(name, 0))
     imgui.igOpenPopup_Str(name, 0);
   if (imgui.igBeginPopupModal(name, nullptr, 0)) {
+    if (detail)
+      imgui.igText("%s", detail);
     imgui.igText("An error has occured, see %s", logfile_path.c_str());
     if (imgui.igButton("Close", ImVec2{}))
       imgui.igCloseCurrentPopup();
@@ -191,12 +229,42 @@ static void popup_error(bool begin, const char *name) {
 
 //--------------------------------------------------------------------------------------------------
 
+static void show_page(std::size_t page) {
+  journal.current_page = std::min(page, journal.pages.size() - 2);
+
+  if (journal.show_titlebar)
+    imgui.igSetNextWindowCollapsed(false, 0);
+  imgui.igSetNextWindowFocus();
+}
+
+/// Not found as is, waits for the word index, which is built a bounded time each frame
+static std::string fuzzy_message;
+
+static void fuzzy_command() {
+  if (fuzzy_message.empty() || !update_word_index(true))
+    return;
+  auto clear = gsl::finally([] { fuzzy_message.clear(); });
+
+  // Misremembered names, all the words have to be close to some on the page
+  auto hits = find_words(fuzzy_message, 1);
+  if (hits.empty() || hits.front().missing) {
+    log() << "Unable to find mod requested string " << fuzzy_message
+          << std::endl;
+    return;
+  }
+  log() << "Mod requested string " << fuzzy_message << " taken as "
+        << hits.front().words << std::endl;
+  show_page(hits.front().page);
+}
+
 /// This must be called before the main window begin()
 
 static void journal_command() {
+  fuzzy_command();
   if (journal_message.empty())
     return;
   auto clear = gsl::finally([] { journal_message.clear(); });
+  fuzzy_message.clear();
 
   auto pos = journal_message.find_last_of('@');
   if (pos != std::string::npos) {
@@ -208,24 +276,30 @@ static void journal_command() {
     journal_message.erase(journal_message.begin() + pos);
   }
 
-  auto it = std::find_if(
-      journal.pages.cbegin(), journal.pages.cend(), [](page_t const &p) {
-        return p.title.find(journal_message) != std::string::npos ||
-               p.content.find(journal_message) != std::string::npos;
-      });
+  // The index rules out the short pages and has the titles in one place, the
+  // pages not in memory are read aside, not loaded
+  auto const &index = page_index();
+  auto const n = journal_message.size();
+  std::size_t page = 0;
+  page_t temp;
+  for (auto it = journal.pages.begin(); page < index.size(); ++page, ++it) {
+    if (index.title_size[page] >= n &&
+        find_text_nocase({index.title(page), index.title_size[page]},
+                         journal_message) != std::string_view::npos)
+      break;
+    if (index.is(page, page_index_t::fetched) && index.content_size[page] < n)
+      continue;
+    if (find_text_nocase(peek_content(*it, temp), journal_message) !=
+        std::string_view::npos)
+      break;
+  }
 
-  if (it == journal.pages.cend()) {
-    log() << "Unable to find mod requested string " << journal_message
-          << std::endl;
+  if (page == index.size()) {
+    fuzzy_message = journal_message;
+    fuzzy_command();
     return;
   }
-
-  auto page = std::distance(journal.pages.cbegin(), it);
-  journal.current_page = std::min(std::size_t(page), journal.pages.size() - 2);
-
-  if (journal.show_titlebar)
-    imgui.igSetNextWindowCollapsed(false, 0);
-  imgui.igSetNextWindowFocus();
+  show_page(page);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -237,8 +311,19 @@ void SSEIMGUI_CCONV render(int active) {
   imgui.igSetNextWindowSize(ImVec2{800, 600}, ImGuiCond_FirstUseEver);
   imgui.igPushFont(journal.default_font.imfont);
 
+  popup_error(!poll_saving(), "Saving failed");
   journal_command();
 
+  // The active text widgets have their own undo
+  auto const &io = *imgui.igGetIO();
+  if (io.KeyCtrl && !imgui.igIsAnyItemActive()) {
+    if (imgui.igIsKeyPressed(imgui.igGetKeyIndex(ImGuiKey_Z), true))
+      io.KeyShift ? redo_edits() : undo_edits();
+    if (imgui.igIsKeyPressed(imgui.igGetKeyIndex(ImGuiKey_Y), true))
+      redo_edits();
+  }
+  update_textures();
+
   if (imgui.igBegin("SSE Journal", nullptr,
                     !journal.show_titlebar * (ImGuiWindowFlags_NoTitleBar |
                                               ImGuiWindowFlags_NoCollapse) |
@@ -259,12 +344,37 @@ void SSEIMGUI_CCONV render(int active) {
   extern void draw_chapters();
   if (journal.show_chapters)
     draw_chapters();
+  extern void draw_search();
+  if (journal.show_search)
+    draw_search();
   extern void draw_saveas();
   if (journal.show_saveas)
     draw_saveas();
   extern void draw_load();
   if (journal.show_load)
     draw_load();
+
+  end_edit_step();
+  log_edits();
+  shelve_pages();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// While its texture is still read, the image area is filled with a faint tint instead
+static void draw_image(image_t const &img, ImVec2 const &tl, ImVec2 const &size) {
+  ImVec2 a{tl.x + size.x * img.xy[0], tl.y + size.y * img.xy[1]};
+  ImVec2 b{tl.x + size.x * img.xy[2], tl.y + size.y * img.xy[3]};
+  if (img.ref)
+    imgui.ImDrawList_AddImage(imgui.igGetWindowDrawList(), img.ref, a, b,
+                              ImVec2{img.uv[0], img.uv[1]},
+                              ImVec2{img.uv[2], img.uv[3]}, img.tint);
+  else if (!img.file.empty()) {
+    auto alpha = ((img.tint >> IM_COL32_A_SHIFT) & 0xff) / 4;
+    imgui.ImDrawList_AddRectFilled(
+        imgui.igGetWindowDrawList(), a, b,
+        (img.tint & ~IM_COL32_A_MASK) | (alpha << IM_COL32_A_SHIFT), 0, 0);
+  }
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -302,6 +412,8 @@ void draw_book() {
     journal.show_elements = !journal.show_elements;
   if (journal.button_chapters.draw())
     journal.show_chapters = !journal.show_chapters;
+  if (journal.button_search.draw())
+    journal.show_search = !journal.show_search;
   if (journal.button_saveas.draw())
     journal.show_saveas = !journal.show_saveas;
   if (journal.button_load.draw())
@@ -319,12 +431,22 @@ void draw_book() {
   if (journal.button_next.draw())
     next_page();
 
+  // Binary books have their pages read only when shown, these which fail stay read only
+  fetch_page(journal.pages[journal.current_page]);
+  fetch_page(journal.pages[journal.current_page + 1]);
+
   imgui.igPushFont(journal.chapter_font.imfont);
   imgui.igPushStyleColor_U32(ImGuiCol_Text, journal.chapter_font.color);
 
   imgui.igSetNextItemWidth(text_width);
   imgui.igSetCursorPos(ImVec2{left_page, title_top});
-  imgui_input_text("##Left title", journal.pages[journal.current_page].title);
+  if (imgui_input_text("##Left title",
+                       journal.pages[journal.current_page].title)) {
+    index_page(journal.pages[journal.current_page]);
+    touch_title(journal.pages[journal.current_page]);
+  }
+  track_typing(journal.pages[journal.current_page],
+               journal.pages[journal.current_page].title);
   if (imgui.igIsItemHovered(0) && !imgui.igIsItemActive())
     imgui.ImDrawList_AddRect(
         imgui.igGetWindowDrawList(),
@@ -335,8 +457,13 @@ void draw_book() {
 
   imgui.igSetCursorPos(ImVec2{right_page, title_top});
   imgui.igSetNextItemWidth(text_width);
-  imgui_input_text("##Right title",
-                   journal.pages[journal.current_page + 1].title);
+  if (imgui_input_text("##Right title",
+                       journal.pages[journal.current_page + 1].title)) {
+    index_page(journal.pages[journal.current_page + 1]);
+    touch_title(journal.pages[journal.current_page + 1]);
+  }
+  track_typing(journal.pages[journal.current_page + 1],
+               journal.pages[journal.current_page + 1].title);
   if (imgui.igIsItemHovered(0) && !imgui.igIsItemActive())
     imgui.ImDrawList_AddRect(
         imgui.igGetWindowDrawList(),
@@ -358,21 +485,17 @@ void draw_book() {
                              IM_COL32_BLACK_TRANS);
 
   auto &left_image = journal.pages[journal.current_page].image;
-  if (left_image.ref) {
-    imgui.ImDrawList_AddImage(
-        imgui.igGetWindowDrawList(), left_image.ref,
-        ImVec2{wpos.x + left_page + text_width * left_image.xy[0],
-               wpos.y + text_top + text_height * left_image.xy[1]},
-        ImVec2{wpos.x + left_page + text_width * left_image.xy[2],
-               wpos.y + text_top + text_height * left_image.xy[3]},
-        ImVec2{left_image.uv[0], left_image.uv[1]},
-        ImVec2{left_image.uv[2], left_image.uv[3]}, left_image.tint);
-  }
-  if (!left_image.ref || left_image.background) {
+  draw_image(left_image, ImVec2{wpos.x + left_page, wpos.y + text_top},
+             ImVec2{text_width, text_height});
+  if (left_image.file.empty() || left_image.background) {
     imgui.igSetCursorPos(ImVec2{left_page, text_top});
-    imgui_input_multiline("##Left text",
-                          journal.pages[journal.current_page].content,
-                          ImVec2{text_width, text_height});
+    if (imgui_input_multiline("##Left text",
+                              journal.pages[journal.current_page].content,
+                              ImVec2{text_width, text_height},
+                              content_flags(journal.pages[journal.current_page])))
+      touch_page(journal.pages[journal.current_page]);
+    track_typing(journal.pages[journal.current_page],
+                 journal.pages[journal.current_page].content);
     if (imgui.igIsItemHovered(0) && !imgui.igIsItemActive())
       imgui.ImDrawList_AddRect(imgui.igGetWindowDrawList(),
                                ImVec2{wpos.x + left_page, wpos.y + text_top},
@@ -382,21 +505,17 @@ void draw_book() {
   }
 
   auto &right_image = journal.pages[journal.current_page + 1].image;
-  if (right_image.ref) {
-    imgui.ImDrawList_AddImage(
-        imgui.igGetWindowDrawList(), right_image.ref,
-        ImVec2{wpos.x + right_page + text_width * right_image.xy[0],
-               wpos.y + text_top + text_height * right_image.xy[1]},
-        ImVec2{wpos.x + right_page + text_width * right_image.xy[2],
-               wpos.y + text_top + text_height * right_image.xy[3]},
-        ImVec2{right_image.uv[0], right_image.uv[1]},
-        ImVec2{right_image.uv[2], right_image.uv[3]}, right_image.tint);
-  }
-  if (!right_image.ref || right_image.background) {
+  draw_image(right_image, ImVec2{wpos.x + right_page, wpos.y + text_top},
+             ImVec2{text_width, text_height});
+  if (right_image.file.empty() || right_image.background) {
     imgui.igSetCursorPos(ImVec2{right_page, text_top});
-    imgui_input_multiline("##Right text",
-                          journal.pages[journal.current_page + 1].content,
-                          ImVec2{text_width, text_height});
+    if (imgui_input_multiline("##Right text",
+                              journal.pages[journal.current_page + 1].content,
+                              ImVec2{text_width, text_height},
+                              content_flags(journal.pages[journal.current_page + 1])))
+      touch_page(journal.pages[journal.current_page + 1]);
+    track_typing(journal.pages[journal.current_page + 1],
+                 journal.pages[journal.current_page + 1].content);
     if (imgui.igIsItemHovered(0) && !imgui.igIsItemActive())
       imgui.ImDrawList_AddRect(imgui.igGetWindowDrawList(),
                                ImVec2{wpos.x + right_page, wpos.y + text_top},
@@ -413,7 +532,7 @@ void draw_book() {
 
 //--------------------------------------------------------------------------------------------------
 
-static std::string greedy_word_wrap(std::string const &source, unsigned width);
+static std::string greedy_word_wrap(std::string_view source, unsigned width);
 
 void
 draw_settings ()
@@ -453,12 +572,44 @@ draw_settings ()
         imgui.igDragInt ("Line width", &wrap_width, 1, 40, 160, "%d", 0);
         if (imgui.igButton ("Wrap", ImVec2 {}))
         {
+            fetch_pages ();
             for (auto& p: journal.pages)
-                p.content = greedy_word_wrap (p.content, wrap_width);
+                edit_content (p, greedy_word_wrap (p.content, wrap_width));
+        }
+
+        imgui.igDummy (ImVec2 { 1, imgui.igGetFrameHeight () });
+        imgui.igText ("Memory:");
+        imgui.igCheckbox ("Compress pages away from the shown ones", &journal.shelf.enabled);
+        imgui.igDragInt ("Pages kept around", &journal.shelf.window, 1, 2, 1000, "%d", 0);
+        imgui.igDragInt ("Uncompressed text", &journal.shelf.budget, 1, 0, 4096, "%d MB", 0);
+        imgui.igDragInt ("Undo history", &journal.history_budget, 1, 0, 4096, "%d MB", 0);
+        imgui.igDragInt ("Image textures", &journal.texture_budget, 1, 0, 4096, "%d MB", 0);
+        if (imgui.igCollapsingHeader_TreeNodeFlags ("Diagnostics", 0))
+        {
+            auto stats = shelf_stats ();
+            auto mb = [] (std::size_t n) { return n / float (1 << 20); };
+            imgui.igText ("Pages in memory: %u, %.1f MB",
+                    unsigned (stats.resident), mb (stats.resident_bytes));
+            imgui.igText ("Compressed pages: %u, %.1f MB into %.1f MB (ratio %.2f)",
+                    unsigned (stats.shelved), mb (stats.shelved_bytes), mb (stats.packed_bytes),
+                    stats.packed_bytes ? stats.shelved_bytes / double (stats.packed_bytes) : 0.);
+            imgui.igText ("Pages left in the book file: %u", unsigned (stats.released));
+            auto undo = history_stats ();
+            imgui.igText ("Undo history: %u steps, %u to redo, %.1f MB",
+                    unsigned (undo.undo), unsigned (undo.redo), mb (undo.bytes));
+            auto tex = texture_stats ();
+            imgui.igText ("Image textures: %u shown, %u cached, %.1f MB",
+                    unsigned (tex.held), unsigned (tex.cached), mb (tex.bytes));
+            imgui.igText ("Image cache: %u hits, %u misses, %u evictions",
+                    unsigned (tex.hits), unsigned (tex.misses), unsigned (tex.evictions));
         }
 
         imgui.igDummy (ImVec2 { 1, imgui.igGetFrameHeight () });
         imgui.igCheckbox ("Show titlebar (allows show & hide)", &journal.show_titlebar);
+        imgui.igCheckbox ("Compact JSON books (smaller, less readable)", &journal.compact_books);
+        if (imgui.igCheckbox ("Binary default book (faster saves, not readable)",
+                    &journal.binary_default))
+            select_default_book ();
         imgui.igDummy (ImVec2 { 1, imgui.igGetFrameHeight () });
 
         bool save_ok = true;
@@ -504,13 +655,15 @@ draw_variables ()
     imgui.igBeginGroup ();
 
     if (imgui.igButton ("Append left", ImVec2 {}))
-        append_input (journal.pages[journal.current_page].content, output);
+        if (fetch_page (journal.pages[journal.current_page]))
+            append_input (journal.pages[journal.current_page], output);
     imgui.igSameLine (0, -1);
     if (imgui.igButton ("Copy to Clipboard", ImVec2 {}))
         imgui.igSetClipboardText (output.c_str ());
     imgui.igSameLine (0, -1);
     if (imgui.igButton ("Append right", ImVec2 {}))
-        append_input (journal.pages[journal.current_page+1].content, output);
+        if (fetch_page (journal.pages[journal.current_page+1]))
+            append_input (journal.pages[journal.current_page+1], output);
 
     if (imgui_input_text ("##Params", params, params_flags))
     {
@@ -657,65 +810,20 @@ extract_vector_string (void* data, int idx, const char** out_text)
 
 //--------------------------------------------------------------------------------------------------
 
-static void
-release_image (image_t& img)
-{
-    auto it = journal.images.find (img.ref);
-    if (it == journal.images.end ())
-        return;
-    if (--it->second.refcount == 0)
-    {
-        it->first->Release ();
-        journal.images.erase (it);
-    }
-    img.ref = nullptr;
-}
-
-//--------------------------------------------------------------------------------------------------
-
-bool
-obtain_image (std::string const& file, image_t& img)
-{
-    auto it = std::find_if (journal.images.begin (), journal.images.end (),
-            [&file] (auto const& kv) { return kv.second.file == file; });
-
-    if (it == journal.images.end ())
-    {
-        ID3D11ShaderResourceView* ref = nullptr;
-        if (!sseimgui.ddsfile_texture (file.c_str (), nullptr, &ref))
-            return false;
-        it = journal.images.emplace (ref, journal_t::image_source_t { 1, std::move (file) }).first;
-    }
-    else if (img.ref == it->first)
-    {
-        return true; // Happens if clicking buttons
-    }
-    else
-    {
-        release_image (img); //if any
-    }
-
-    img.ref = it->first;
-    ++it->second.refcount;
-    return true;
-}
-
-//--------------------------------------------------------------------------------------------------
-
-static void
+static bool
 imgui_range_widget (const char* label, float& l, float& r)
 {
     // Can't figure it out with DragFloatRange2
     float v[2] = { l, r };
-    if (imgui.igDragFloat2 (label, v, .001f, 0, 1, "%.2f", 1))
-    {
-        v[0] = std::min (v[0], 1.f); // Manual input can override, according to the ImGui docs
-        v[1] = std::max (v[1], 0.f);
-        if (v[0] != l && l > r) l = r;
-        if (v[1] != r && r < l) r = l;
-        l = v[0];
-        r = v[1];
-    }
+    if (!imgui.igDragFloat2 (label, v, .001f, 0, 1, "%.2f", 1))
+        return false;
+    v[0] = std::min (v[0], 1.f); // Manual input can override, according to the ImGui docs
+    v[1] = std::max (v[1], 0.f);
+    if (v[0] != l && l > r) l = r;
+    if (v[1] != r && r < l) r = l;
+    l = v[0];
+    r = v[1];
+    return true;
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -734,8 +842,11 @@ draw_images ()
         | ImGuiColorEditFlags_DisplayHSV | ImGuiColorEditFlags_InputRGB
         | ImGuiColorEditFlags_PickerHueBar;
 
+    fetch_page (journal.pages[journal.current_page]);
+    fetch_page (journal.pages[journal.current_page+1]);
     auto& left_image = journal.pages[journal.current_page].image;
     auto& right_image = journal.pages[journal.current_page+1].image;
+    auto left_before = left_image, right_before = right_image;
 
     ImVec2 cregavail;
     imgui.igGetContentRegionAvail (&cregavail);
@@ -749,43 +860,63 @@ draw_images ()
     imgui.igPushItemWidth (sidew);
     imgui.igBeginGroup ();
 
+    bool changed = false;
     imgui.igBeginGroup ();
     if (imgui.igButton ("Show##left", ImVec2 {sidew, 0}) && namesel >= 0)
-        if (!obtain_image (images_directory + names[namesel] + ".dds"s, left_image))
-            namesel = -1;
+        changed = true, assign_image (images_directory + names[namesel] + ".dds"s, left_image);
     if (imgui.igButton ("Hide##left", ImVec2 {sidew, 0}))
-        release_image (left_image);
+        changed = true, assign_image ({}, left_image);
     imgui.igText ("Texture UV");
-    imgui_range_widget ("##Uleft", left_image.uv[0], left_image.uv[2]);
-    imgui_range_widget ("##Vleft", left_image.uv[1], left_image.uv[3]);
+    changed |= imgui_range_widget ("##Uleft", left_image.uv[0], left_image.uv[2]);
+    changed |= imgui_range_widget ("##Vleft", left_image.uv[1], left_image.uv[3]);
     imgui.igText ("Position XY");
-    imgui_range_widget ("##Xleft", left_image.xy[0], left_image.xy[2]);
-    imgui_range_widget ("##Yleft", left_image.xy[1], left_image.xy[3]);
-    imgui.igCheckbox ("Background##left", &left_image.background);
+    changed |= imgui_range_widget ("##Xleft", left_image.xy[0], left_image.xy[2]);
+    changed |= imgui_range_widget ("##Yleft", left_image.xy[1], left_image.xy[3]);
+    changed |= imgui.igCheckbox ("Background##left", &left_image.background);
     left_tint = igColorConvertU32ToFloat4 (left_image.tint);
-    imgui.igColorEdit4 ("Tint##left", (float*) &left_tint, color_flags);
-    left_image.tint = imgui.igColorConvertFloat4ToU32 (left_tint);
+    if (imgui.igColorEdit4 ("Tint##left", (float*) &left_tint, color_flags))
+        changed = true, left_image.tint = imgui.igColorConvertFloat4ToU32 (left_tint);
     imgui.igEndGroup ();
+    if (changed && journal.pages[journal.current_page].broken)
+    {
+        release_image (left_image);
+        left_image = left_before;
+    }
+    else if (changed)
+    {
+        image_edited (journal.pages[journal.current_page], left_before);
+        touch_page (journal.pages[journal.current_page]);
+    }
 
     imgui.igSameLine (0, -1);
 
+    changed = false;
     imgui.igBeginGroup ();
     if (imgui.igButton ("Show##right", ImVec2 {sidew, 0}) && namesel >= 0)
-        if (!obtain_image (images_directory + names[namesel] + ".dds"s, right_image))
-            namesel = -1;
+        changed = true, assign_image (images_directory + names[namesel] + ".dds"s, right_image);
     if (imgui.igButton ("Hide##right", ImVec2 {sidew, 0}))
-        release_image (right_image);
+        changed = true, assign_image ({}, right_image);
     imgui.igText ("");
-    imgui_range_widget ("##Uright", right_image.uv[0], right_image.uv[2]);
-    imgui_range_widget ("##Vright", right_image.uv[1], right_image.uv[3]);
+    changed |= imgui_range_widget ("##Uright", right_image.uv[0], right_image.uv[2]);
+    changed |= imgui_range_widget ("##Vright", right_image.uv[1], right_image.uv[3]);
     imgui.igText ("");
-    imgui_range_widget ("##Xright", right_image.xy[0], right_image.xy[2]);
-    imgui_range_widget ("##Yright", right_image.xy[1], right_image.xy[3]);
-    imgui.igCheckbox ("Background##right", &right_image.background);
+    changed |= imgui_range_widget ("##Xright", right_image.xy[0], right_image.xy[2]);
+    changed |= imgui_range_widget ("##Yright", right_image.xy[1], right_image.xy[3]);
+    changed |= imgui.igCheckbox ("Background##right", &right_image.background);
     right_tint = igColorConvertU32ToFloat4 (right_image.tint);
-    imgui.igColorEdit4 ("Tint##right", (float*) &right_tint, color_flags);
-    right_image.tint = imgui.igColorConvertFloat4ToU32 (right_tint);
+    if (imgui.igColorEdit4 ("Tint##right", (float*) &right_tint, color_flags))
+        changed = true, right_image.tint = imgui.igColorConvertFloat4ToU32 (right_tint);
     imgui.igEndGroup ();
+    if (changed && journal.pages[journal.current_page+1].broken)
+    {
+        release_image (right_image);
+        right_image = right_before;
+    }
+    else if (changed)
+    {
+        image_edited (journal.pages[journal.current_page+1], right_before);
+        touch_page (journal.pages[journal.current_page+1]);
+    }
 
     imgui.igEndGroup ();
     imgui.igPopItemWidth ();
@@ -819,23 +950,12 @@ draw_elements ()
 
 //--------------------------------------------------------------------------------------------------
 
-static bool
-visible_symbols (std::string const& s)
-{
-    if (!s.empty ()) for (auto p = s.c_str (); *p; ++p)
-        if (*p != ' ' && !std::iscntrl (*p))
-            return true;
-    return false;
-}
-
-//--------------------------------------------------------------------------------------------------
-
 static bool
 extract_chapter_title (void* data, int idx, const char** out_text)
 {
-    auto const& title = journal.pages[idx].title;
-    if (visible_symbols (title))
-        *out_text = title.c_str ();
+    auto const& index = *reinterpret_cast<page_index_t const*> (data);
+    if (index.is (idx, page_index_t::visible_title))
+        *out_text = index.title (idx);
     else
         *out_text = "(n/a)";
     return true;
@@ -850,8 +970,9 @@ draw_chapters ()
     imgui.igPushFont (journal.default_font.imfont);
     if (imgui.igBegin ("SSE Journal: Chapters", &journal.show_chapters, 0))
     {
-        if (imgui.igListBox_FnBoolPtr ("##Chapters", &selection, extract_chapter_title, nullptr,
-                int (journal.pages.size ()), items))
+        auto const& index = page_index ();
+        if (imgui.igListBox_FnBoolPtr ("##Chapters", &selection, extract_chapter_title,
+                const_cast<page_index_t*> (&index), int (index.size ()), items))
         {
             int ndx = selection;
             if (ndx + 1 == int (journal.pages.size ()))
@@ -866,14 +987,12 @@ draw_chapters ()
         if (imgui.igButton ("Insert before", ImVec2 {-1, 0}))
         {
             if (selection >= 0 && selection < int (journal.pages.size ()))
-                adjust = true,
-                journal.pages.insert (journal.pages.begin () + selection, page_t {});
+                adjust = true, insert_pages (selection, 1);
         }
         if (imgui.igButton ("Insert after", ImVec2 {-1, 0}))
         {
             if (selection >= 0 && selection < int (journal.pages.size ()))
-                adjust = true,
-                journal.pages.insert (journal.pages.begin () + selection + 1, page_t {});
+                adjust = true, insert_pages (selection + 1, 1);
         }
         if (imgui.igButton ("Delete", ImVec2 {-1, 0}))
             if (selection >= 0 && selection < int (journal.pages.size ()))
@@ -883,17 +1002,21 @@ draw_chapters ()
             if (imgui.igButton ("Are you sure?##Chapter", ImVec2 {}))
             {
                 adjust = true;
-                journal.pages.erase (journal.pages.begin () + selection);
+                erase_pages (selection, 1);
                 imgui.igCloseCurrentPopup ();
             }
             imgui.igEndPopup ();
         }
+        if (imgui.igButton ("Undo", ImVec2 {-1, 0}))
+            undo_edits ();
+        if (imgui.igButton ("Redo", ImVec2 {-1, 0}))
+            redo_edits ();
         imgui.igEndGroup ();
 
         if (adjust)
         {
             if (journal.pages.size () < 2)
-                journal.pages.resize (2);
+                insert_pages (journal.pages.size (), 2 - journal.pages.size ());
             while (journal.current_page+2 > journal.pages.size ())
                 journal.current_page--;
         }
@@ -906,12 +1029,182 @@ draw_chapters ()
 
 //--------------------------------------------------------------------------------------------------
 
+/// A row of the search results, true if clicked
+static bool
+draw_search_hit (int i, const char* where, std::size_t page, const char* title,
+                 std::string const& snippet)
+{
+    // The snippet is not a label, it may have anything, ## included
+    imgui.igPushID_Int (i);
+    float x = imgui.igGetCursorPosX ();
+    bool clicked = imgui.igSelectable_Bool ("##Hit", false, 0, ImVec2 {});
+    imgui.igPopID ();
+    imgui.igSameLine (x, -1);
+    if (where)
+    {
+        imgui.igTextUnformatted (where, nullptr);
+        imgui.igSameLine (0, -1);
+    }
+    imgui.igTextDisabled ("%u", unsigned (page + 1));
+    if (title)
+    {
+        imgui.igSameLine (0, -1);
+        imgui.igTextUnformatted (title, nullptr);
+    }
+    imgui.igSameLine (0, -1);
+    imgui.igTextUnformatted (snippet.c_str (), nullptr);
+    return clicked;
+}
+
+static void
+show_found_page (std::size_t page)
+{
+    if (page + 1 >= journal.pages.size ())
+        page = journal.pages.size () - 2;
+    journal.current_page = unsigned (page);
+}
+
+void
+draw_search ()
+{
+    static std::string query;
+    static bool match_case = false;
+    static bool library = false;
+    static bool fuzzy = false;
+
+    imgui.igPushFont (journal.default_font.imfont);
+    if (imgui.igBegin ("SSE Journal: Search", &journal.show_search, 0))
+    {
+        if (imgui.igIsWindowAppearing ())
+            imgui.igSetKeyboardFocusHere (0);
+        imgui_input_text ("##Query", query);
+        imgui.igSameLine (0, -1);
+        imgui.igCheckbox ("Fuzzy", &fuzzy);
+        if (!fuzzy)
+        {
+            imgui.igSameLine (0, -1);
+            imgui.igCheckbox ("Match case", &match_case);
+            imgui.igSameLine (0, -1);
+            imgui.igCheckbox ("All books", &library);
+        }
+        if (library && !fuzzy)
+        {
+            imgui.igSameLine (0, -1);
+            search_library (query, match_case, imgui.igButton ("Again", ImVec2 {}));
+        }
+
+        std::size_t matches, listed;
+        search_state_t const* pages = nullptr;
+        library_state_t const* books = nullptr;
+        fuzzy_state_t const* close = nullptr;
+        if (fuzzy)
+        {
+            fuzzy_search (query);
+            auto const& st = *(close = &continue_fuzzy_search ());
+            if (st.indexed < st.pages)
+                imgui.igText ("%u pages, indexed %u of %u pages",
+                        unsigned (st.hits.size ()), unsigned (st.indexed), unsigned (st.pages));
+            else
+                imgui.igText ("%u pages", unsigned (st.hits.size ()));
+            matches = listed = st.hits.size ();
+        }
+        else if (library)
+        {
+            auto const& st = *(books = &continue_library_search ());
+            if (st.searched < st.books)
+                imgui.igText ("%u matches, searched %u of %u books",
+                        unsigned (st.matches), unsigned (st.searched), unsigned (st.books));
+            else
+                imgui.igText ("%u matches in %u books", unsigned (st.matches), unsigned (st.books));
+            matches = st.matches, listed = st.hits.size ();
+        }
+        else
+        {
+            search_pages (query, match_case);
+            auto const& st = *(pages = &continue_search ());
+            if (st.searched < st.pages)
+                imgui.igText ("%u matches, searched %u of %u pages",
+                        unsigned (st.matches), unsigned (st.searched), unsigned (st.pages));
+            else
+                imgui.igText ("%u matches", unsigned (st.matches));
+            matches = st.matches, listed = st.hits.size ();
+        }
+        if (matches > listed)
+        {
+            imgui.igSameLine (0, -1);
+            imgui.igTextDisabled ("(the first %u are listed)", unsigned (listed));
+        }
+
+        bool load_ok = true;
+        if (imgui.igBeginChild_Str ("##Hits", ImVec2 {0, 0}, false, 0))
+        {
+            auto const& index = page_index ();
+            auto clipper = imgui.ImGuiListClipper_ImGuiListClipper ();
+            imgui.ImGuiListClipper_Begin (clipper, int (listed), -1);
+            while (imgui.ImGuiListClipper_Step (clipper))
+                for (int i = clipper->DisplayStart; i < clipper->DisplayEnd; ++i)
+                {
+                    if (close)
+                    {
+                        // Ranked, the words taken for the query ones tell why
+                        auto const& hit = close->hits[i];
+                        bool titled = index.is (hit.page, page_index_t::visible_title);
+                        if (draw_search_hit (i, nullptr, hit.page,
+                                titled ? index.title (hit.page) : nullptr, hit.words)
+                                && hit.page < journal.pages.size ())
+                            show_found_page (hit.page);
+                        continue;
+                    }
+                    if (!library)
+                    {
+                        auto const& hit = pages->hits[i];
+                        bool titled = !hit.title
+                                && index.is (hit.page, page_index_t::visible_title);
+                        if (draw_search_hit (i, nullptr, hit.page,
+                                titled ? index.title (hit.page) : nullptr, hit.snippet)
+                                && hit.page < journal.pages.size ())
+                            show_found_page (hit.page);
+                        continue;
+                    }
+
+                    auto const& hit = books->hits[i];
+                    auto name = hit.book.substr (books_directory.size ());
+                    if (draw_search_hit (i, name.c_str (), hit.page, nullptr, hit.snippet))
+                    {
+                        load_ok = hit.book.ends_with (".xml")
+                            ? load_takenotes (hit.book) : load_book (hit.book);
+                        if (load_ok && hit.page < journal.pages.size ())
+                            show_found_page (hit.page);
+                    }
+                }
+            imgui.ImGuiListClipper_destroy (clipper);
+        }
+        imgui.igEndChild ();
+        popup_error (!load_ok, "Load book failed");
+    }
+    imgui.igEnd ();
+    imgui.igPopFont ();
+}
+
+//--------------------------------------------------------------------------------------------------
+
 void
 draw_saveas ()
 {
     static std::string name;
     static int typesel = 0;
-    static std::array<const char*, 2> types = { "Journal book (*.json)", "Plain text (*.txt)" };
+    static std::array<const char*, 6> types = {
+        "Journal book (*.json)", "Plain text (*.txt)", "Journal binary book (*.jbook)",
+        "Journal compressed book (*.jbz)", "Journal CBOR book (*.cbor)",
+        "Journal MessagePack book (*.msgpack)" };
+    static std::array<const char*, 6> extensions = {
+        ".json", ".txt", ".jbook", ".jbz", ".cbor", ".msgpack" };
+
+    // The window stays open until the save is done, as it may yet fail writing
+    static struct {
+        bool pending, failed;
+        std::string file;
+    } saveas;
 
     imgui.igPushFont (journal.default_font.imfont);
     if (imgui.igBegin ("SSE Journal: Save as file", &journal.show_saveas, 0))
@@ -922,15 +1215,23 @@ draw_saveas ()
         if (imgui.igButton ("Cancel", ImVec2 {}))
             journal.show_saveas = false;
         imgui.igSameLine (0, -1);
-        if (imgui.igButton ("Save", ImVec2 {}))
+        if (saveas.pending)
+            imgui.igText ("Saving %s...", saveas.file.c_str ());
+        else if (imgui.igButton ("Save", ImVec2 {}))
         {
-            bool ok = true;
-            auto root = books_directory + name.c_str ();
-            if (typesel == 0) ok = save_book (root + ".json");
-            if (typesel == 1) ok = save_text (root + ".txt");
-            popup_error (!ok, "Save As failed");
-            if (ok) journal.show_saveas = false;
+            saveas.file = books_directory + name + extensions[typesel];
+            auto saved = [] (bool ok)
+            {
+                saveas.pending = false;
+                saveas.failed = !ok;
+                journal.show_saveas = !ok; // Back to show the error, if closed meanwhile
+            };
+            saveas.pending = typesel == 1 ? save_text (saveas.file, saved)
+                                          : save_book (saveas.file, saved);
+            saveas.failed = !saveas.pending;
         }
+        popup_error (std::exchange (saveas.failed, false), "Save As failed",
+                ("Unable to save " + saveas.file).c_str ());
     }
     imgui.igEnd ();
     imgui.igPopFont ();
@@ -943,8 +1244,12 @@ draw_load ()
 {
     static int typesel = 0;
     static int namesel = -1;
-    static std::array<const char*, 2> types = { "Journal book (*.json)", "Take Notes (*.xml)" };
-    static std::array<const char*, 2> filters = { "*.json", "*.xml" };
+    static std::array<const char*, 6> types = {
+        "Journal book (*.json)", "Take Notes (*.xml)", "Journal binary book (*.jbook)",
+        "Journal compressed book (*.jbz)", "Journal CBOR book (*.cbor)",
+        "Journal MessagePack book (*.msgpack)" };
+    static std::array<const char*, 6> filters = {
+        "*.json", "*.xml", "*.jbook", "*.jbz", "*.cbor", "*.msgpack" };
     static std::vector<std::string> names;
     static bool reload_names = false;
     static float items = -1;
@@ -973,6 +1278,10 @@ draw_load ()
             auto target = books_directory + names[namesel];
             if (typesel == 0) ok = load_book (target + ".json");
             if (typesel == 1) ok = load_takenotes (target + ".xml");
+            if (typesel == 2) ok = load_book (target + ".jbook");
+            if (typesel == 3) ok = load_book (target + ".jbz");
+            if (typesel == 4) ok = load_book (target + ".cbor");
+            if (typesel == 5) ok = load_book (target + ".msgpack");
             popup_error (!ok, "Load book failed");
             if (ok) journal.show_load = false;
         }
@@ -1001,17 +1310,16 @@ next_page ()
 {
     if (journal.current_page+2 < journal.pages.size ())
         journal.current_page++;
-    // New page if not whitespaces only. It is a bit heurestic and must be careful with regard to
-    // the UTF-8 symbols, hence bare safe assumptions were made in the ASCII range. It helps avoid
-    // including some sophisticated library for handling unicode. While the Viner font provides
-    // very few symbols, merging within an icon font or other utf-8 rich one, will cause issues if
-    // not cautious.
+    // New page if not whitespaces only, as told by the UTF-8 code points (@see visible_symbols)
     else if (journal.current_page + 2 == journal.pages.size ())
     {
-        if (visible_symbols (journal.pages.back ().title)
-                || visible_symbols (journal.pages.back ().content))
+        fetch_page (journal.pages.back ());
+        auto const& index = page_index ();
+        auto last = index.size () - 1;
+        if (index.is (last, page_index_t::visible_title)
+                || index.is (last, page_index_t::visible_content))
         {
-            journal.pages.push_back (page_t {});
+            insert_pages (journal.pages.size (), 1);
             journal.current_page++;
         }
     }
@@ -1019,34 +1327,46 @@ next_page ()
 
 //--------------------------------------------------------------------------------------------------
 
+/// The width is in code points, so that the non-Latin lines are not wrapped at half of it or less
 static std::string
-greedy_word_wrap (std::string const& source, unsigned width)
+greedy_word_wrap (std::string_view source, unsigned width)
 {
-    auto n = std::strlen (source.c_str ());
-    std::string out (n, 0);
-
-    for (unsigned i = 0; i < n; )
+    constexpr auto none = std::string::npos;
+    std::string out;
+    out.reserve (source.size ());
+    unsigned column = 0;
+    std::size_t space = none, space_size = 0;   // The last one on the line, in the output
+    unsigned space_column = 0;
+
+    for (std::size_t i = 0, n; i < source.size (); i += n)
     {
-        // copy string until the end of the line is reached
-        for (unsigned c = 1; c <= width; ++c, ++i)
+        char32_t c;
+        n = utf8_decode (source, i, c);
+        // The no-break spaces are not to break on
+        bool breaks = is_space (c) && c != 0xa0 && c != 0x2007 && c != 0x202f;
+
+        if (c == '\n')
+            column = 0, space = none;
+        else if (column >= width && breaks)
+        {
+            out += '\n';
+            column = 0, space = none;
+            continue;
+        }
+        else if (column >= width && space != none)
         {
-            if (i == n)
-                return out;
-            out[i] = source[i];
-            if (source[i] == '\n')
-                c = 1;
+            out.replace (space, space_size, 1, '\n');
+            column -= space_column + 1;
+            space = none;
         }
 
-        if (std::isspace (source[i]))
-            out[i++] = '\n';
-        // check for nearest whitespace back in string
-        else for (unsigned k = i; k > 0; --k)
-            if (std::isspace (source[k]))
-            {
-                out[k] = '\n';
-                i = k + 1;
-                break;
-            }
+        if (c != '\n')
+        {
+            if (breaks)
+                space = out.size (), space_size = n, space_column = column;
+            ++column;
+        }
+        out.append (source.substr (i, n));
     }
     return out;
 }
@@ -0,0 +1,164 @@
+/**
+ * @file shelf.cpp
+ * @brief In memory compression of the pages away from the shown ones
+ * @internal
+ *
+ * This file is part of Skyrim SE Journal mod (aka Journal).
+ *
+ *   Journal is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Journal is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Journal. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Core
+ *
+ * @details
+ * A shelved page keeps its title and image, only its content is compressed (with the codec of the
+ * packed books) and released. Clean pages of a binary book are not compressed, but released back
+ * to their record, as if never fetched. Either way the page is not loaded anymore, so fetch_page ()
+ * brings it back once it is shown, searched or saved.
+ *
+ * While the not shelved text beyond the window around the shown pages is over the budget, the
+ * farthest pages go first. Each frame compresses a bounded amount only, to not stall it.
+ */
+
+#include "sse-journal.hpp"
+#include <utils/lz.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+//--------------------------------------------------------------------------------------------------
+
+namespace {
+
+/// Compression time per frame, at least one page is done anyway
+constexpr auto frame_work = std::chrono::microseconds (2000);
+
+/// Whatever the setting, as the page turns show these next and their images are loaded ahead,
+/// else these would be fetched and shelved again each frame
+constexpr int min_window = 2;
+
+void
+shelve (page_t& page)
+{
+    if (release_page (page))
+        return;
+    auto n = std::uint32_t (page.content.size ());
+    page.packed.assign (reinterpret_cast<const char*> (&n), sizeof (n));
+    lz_compress (page.content.c_str (), n, page.packed);
+    page.packed.shrink_to_fit ();
+    page.content.release ();
+    page.loaded = false;
+    index_page (page);
+}
+
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void
+shelve_pages ()
+{
+    if (!journal.shelf.enabled)
+        return;
+
+    auto const& index = page_index ();
+    std::size_t window = std::max (journal.shelf.window, min_window);
+    std::size_t first = journal.current_page > window ? journal.current_page - window : 0;
+    std::size_t last = std::min (index.size (), journal.current_page + 2 + window);
+    auto kept = [&] (std::size_t i) {
+        return (first <= i && i < last) || !index.is (i, page_index_t::fetched)
+            || !index.content_size[i];
+    };
+
+    std::uint64_t resident = 0;
+    for (std::size_t i = 0; i < index.size (); ++i)
+        if (!kept (i)) resident += index.content_size[i];
+    std::uint64_t budget = std::uint64_t (std::max (journal.shelf.budget, 0)) << 20;
+    if (resident <= budget)
+        return;
+
+    std::vector<std::size_t> far;
+    for (std::size_t i = 0; i < index.size (); ++i)
+        if (!kept (i)) far.push_back (i);
+    auto distance = [current = std::size_t (journal.current_page)] (std::size_t i) {
+        return i < current ? current - i : i - current;
+    };
+    std::sort (far.begin (), far.end (),
+            [&] (auto a, auto b) { return distance (a) > distance (b); });
+
+    auto deadline = std::chrono::steady_clock::now () + frame_work;
+    for (auto i: far)
+    {
+        if (resident <= budget)
+            break;
+        resident -= index.content_size[i];
+        shelve (journal.pages[i]);
+        if (std::chrono::steady_clock::now () > deadline)
+            break;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool
+unshelve_page (page_t& page)
+{
+    std::uint32_t n;
+    bool ok = page.packed.size () >= sizeof (n);
+    if (ok)
+    {
+        std::memcpy (&n, page.packed.data (), sizeof (n));
+        page.content.resize (n);
+        ok = lz_decompress (page.packed.data () + sizeof (n), page.packed.size () - sizeof (n),
+                            page.content.data (), n);
+    }
+    if (!ok)
+    {
+        page.content.clear ();
+        return false;
+    }
+    std::string ().swap (page.packed);
+    page.loaded = true;
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+shelf_stats_t
+shelf_stats ()
+{
+    shelf_stats_t stats {};
+    for (auto const& p: journal.pages)
+    {
+        if (p.loaded)
+        {
+            stats.resident++;
+            stats.resident_bytes += p.content.size ();
+        }
+        else if (!p.packed.empty ())
+        {
+            std::uint32_t n;
+            std::memcpy (&n, p.packed.data (), sizeof (n));
+            stats.shelved++;
+            stats.shelved_bytes += n;
+            stats.packed_bytes += p.packed.size ();
+        }
+        else stats.released++;
+    }
+    return stats;
+}
+
+//--------------------------------------------------------------------------------------------------
+
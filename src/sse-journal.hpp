@@ -30,6 +30,8 @@
 
 #include <sse-imgui/sse-imgui.h>
 #include <utils/winutils.hpp>
+#include <utils/text.hpp>
+#include <utils/chunked.hpp>
 
 #include <d3d11.h>
 
@@ -39,7 +41,11 @@
 #include <map>
 #include <vector>
 #include <utility>
+#include <string_view>
 #include <functional>
+#include <atomic>
+#include <memory_resource>
+#include <algorithm>
 
 //--------------------------------------------------------------------------------------------------
 
@@ -58,10 +64,24 @@ extern sseimgui_api sseimgui;
 
 // fileio.cpp
 
-bool save_text (std::string const& destination);
-bool save_book (std::string const& destination);
+struct page_t;
+
+/// Called on the render thread once a queued save is done, instead of the common failure report
+using saved_t = std::function<void (bool ok)>;
+
+bool save_text (std::string const& destination, saved_t saved = nullptr);
+bool save_book (std::string const& destination, saved_t saved = nullptr);
 bool load_book (std::string const& source);
+bool load_default_book ();
+void select_default_book ();
 bool load_takenotes (std::string const& source);
+bool read_book_pages (std::string const& source,
+        std::function<void (std::size_t, std::string_view, std::string_view)> const& visit);
+bool fetch_page (page_t& page);
+bool fetch_pages ();
+bool release_page (page_t& page);
+std::string_view peek_content (page_t const& page, page_t& temp);
+bool poll_saving ();
 bool save_settings ();
 bool load_settings ();
 bool save_variables ();
@@ -72,6 +92,204 @@ extern std::string books_directory;
 extern std::string default_book;
 extern std::string settings_location;
 extern std::string images_directory;
+extern std::string edit_log_location;
+
+//--------------------------------------------------------------------------------------------------
+
+// editlog.cpp
+
+void touch_page (page_t& page);
+void touch_title (page_t const& page);
+void log_edits ();
+void log_loaded (std::string const& source);
+bool replay_edit_log ();
+std::uint64_t edit_log_mark (std::string const& destination);
+void fold_edit_log (std::uint64_t mark, std::string const& saved, bool ok);
+
+//--------------------------------------------------------------------------------------------------
+
+// history.cpp
+
+struct image_t;
+
+struct history_stats_t
+{
+    std::size_t undo, redo;     ///< Steps
+    std::size_t bytes;
+};
+
+/// Records the change and applies it, the content is fetched first (nothing done if it fails)
+void edit_content (page_t& page, std::string_view content);
+void replace_content (page_t& page, std::size_t pos, std::size_t n, std::string_view s);
+/// Around the in place edits of a text widget, @p text is the page title or content
+void typing_started (std::string_view text);
+void typing_ended (page_t& page, text_buffer const& text);
+/// Records an already done change
+void image_edited (page_t const& page, image_t const& before);
+/// Any change to the page order must go through these, for the undo steps to stay valid
+void insert_pages (std::size_t at, std::size_t n);
+void erase_pages (std::size_t at, std::size_t n);
+void end_edit_step ();
+bool undo_edits ();
+bool redo_edits ();
+void forget_edits ();
+void drop_erased_records ();
+history_stats_t history_stats ();
+
+//--------------------------------------------------------------------------------------------------
+
+// shelf.cpp
+
+/// Diagnostics of the shelved pages, sizes are of the content only
+struct shelf_stats_t
+{
+    std::size_t resident, resident_bytes;       ///< Content in memory
+    std::size_t shelved, shelved_bytes, packed_bytes;
+    std::size_t released;                       ///< Back in their binary book record
+};
+
+/// Call once a frame, compresses a bounded amount of pages at a time
+void shelve_pages ();
+/// Decompresses the content of a shelved page, safe on any copy of the page. On failure the page
+/// stays shelved, not loaded and with its packed bytes (@see fetch_page)
+bool unshelve_page (page_t& page);
+shelf_stats_t shelf_stats ();
+
+//--------------------------------------------------------------------------------------------------
+
+// textures.cpp
+
+struct texture_stats_t
+{
+    std::size_t held, cached;       ///< Textures on pages, and these kept only by the cache
+    std::size_t bytes;              ///< Estimated video memory of both
+    std::size_t hits, misses, evictions;
+};
+
+/// The texture is left for update_textures (), it is read on a worker thread
+void assign_image (std::string const& file, image_t& img);
+/// Drops the texture only, the image file stays
+void release_image (image_t& img);
+/// Call once a frame, before the pages are drawn
+void update_textures ();
+texture_stats_t texture_stats ();
+
+//--------------------------------------------------------------------------------------------------
+
+// pagesearch.cpp
+
+struct search_hit_t
+{
+    std::size_t page;
+    bool title;                 ///< Else in the content
+    std::string snippet;        ///< The match with some text around, on one line
+};
+
+struct search_state_t
+{
+    std::string query;
+    bool match_case;
+    std::vector<search_hit_t> hits;     ///< In the book order, the first matches only
+    std::size_t matches;                ///< All found so far
+    std::size_t searched, pages;        ///< Done when equal
+};
+
+/// Starts the search over, if any argument differs from the current one
+void search_pages (std::string_view query, bool match_case);
+/// Call once a frame while the results are shown, searches the next pages for a bounded time
+search_state_t const& continue_search ();
+
+struct library_hit_t
+{
+    std::string book;           ///< The file
+    std::size_t page;
+    bool title;
+    std::string snippet;
+};
+
+struct library_state_t
+{
+    std::string query;
+    bool match_case;
+    std::vector<library_hit_t> hits;    ///< As the books are done, the first matches only
+    std::size_t matches;
+    std::size_t searched, books;        ///< Done when equal
+};
+
+/// Searches all books in the books directory on worker threads, restarts if the arguments differ
+/// or if asked @p again (as for changed files)
+void search_library (std::string_view query, bool match_case, bool again = false);
+/// Takes in the matches of the books done since the last call
+library_state_t const& continue_library_search ();
+
+//--------------------------------------------------------------------------------------------------
+
+// wordindex.cpp
+
+struct word_hit_t
+{
+    std::size_t page;
+    float score;                ///< Up to one, less for each edit and missing word
+    std::size_t missing;        ///< Query words not on the page
+    std::string words;          ///< These on the page taken for the query ones
+};
+
+struct fuzzy_state_t
+{
+    std::string query;
+    std::vector<word_hit_t> hits;       ///< Best first, the first ones only
+    std::size_t indexed, pages;         ///< The index is complete when equal
+};
+
+/// The page title or content may have changed, called by index_page ()
+void reindex_words (page_t const& page);
+/// Indexes the new and changed pages, for a bounded time if @p bounded, true if all are done
+bool update_word_index (bool bounded);
+/// The pages with words within a few edits of these in @p query, best first
+std::vector<word_hit_t> find_words (std::string_view query, std::size_t max_hits);
+/// Starts the search over, if the query differs from the current one
+void fuzzy_search (std::string_view query);
+/// Call once a frame while the results are shown, indexes the next pages for a bounded time
+fuzzy_state_t const& continue_fuzzy_search ();
+
+//--------------------------------------------------------------------------------------------------
+
+// pageindex.cpp
+
+/**
+ * Compact metadata of all pages in parallel arrays, one element per page in the book order.
+ *
+ * The chapters list, the navigation and the search passes walk these instead of the pages. The
+ * content fields are known only for the pages read from their binary book (@see fetched).
+ */
+
+struct page_index_t
+{
+    enum : std::uint8_t {
+        fetched = 1,
+        visible_title = 2,
+        visible_content = 4,
+        has_image = 8
+    };
+
+    std::vector<std::uint32_t> ids;
+    std::vector<std::uint32_t> title_offset, title_size;  ///< In #titles, NUL terminated there
+    std::vector<std::uint32_t> content_size;
+    std::vector<std::uint8_t> flags;
+    std::vector<std::size_t> hash;                      ///< Of the content
+    std::string titles;
+
+    std::size_t size () const { return ids.size (); }
+    const char* title (std::size_t i) const { return titles.data () + title_offset[i]; }
+    bool is (std::size_t i, std::uint8_t flag) const { return flags[i] & flag; }
+};
+
+/// Not whitespaces or control codes only, as UTF-8 code points
+bool visible_symbols (std::string_view s);
+/// The page title, content or image changed
+void index_page (page_t const& page);
+/// Up to date with the book, valid until the next change of it
+page_index_t const& page_index ();
 
 //--------------------------------------------------------------------------------------------------
 
@@ -114,19 +332,37 @@ public:
 
 struct image_t
 {
-    bool background;    ///< Will be there text above it?
+    bool background = false;    ///< Will be there text above it?
     std::uint32_t tint = IM_COL32_WHITE;
     /// top left & bottom right points for texture and position
     std::array<float, 4> uv = {{ 0, 0, 1, 1 }}, xy = {{ 0, 0, 1, 1 }};
-    ID3D11ShaderResourceView* ref;
+    std::string file;                       ///< The DDS, none if empty
+    ID3D11ShaderResourceView* ref = nullptr;///< Texture, only around the shown pages
 };
 
+/// Page texts, the loaded books allocate them from their text store (@see text_store_t)
+using text_t = text_buffer;
+
 struct page_t
 {
-    std::string title, content;
+    page_t () = default;
+    explicit page_t (std::pmr::memory_resource* texts) : title (texts), content (texts) {}
+
+    text_t title, content;
     image_t image;
+    std::uint64_t record = 0;   ///< Offset of the page record in the binary book, if any
+    bool loaded = true;         ///< Content & image are still in the binary book (@see fetch_page)
+    bool dirty = true;          ///< Content or image differ from the binary book record
+    bool broken = false;        ///< The record or shelved content is unreadable, kept read only
+    std::string packed;         ///< Shelved content, u32 size and LZ block (@see shelve_pages)
+    std::uint32_t id = ++serial;///< Tells the page apart for the background saves
+
+    static inline std::atomic<std::uint32_t> serial;
 };
 
+/// The pages never move, so references to them stay valid across chapter inserts and erases
+using page_list_t = chunked_vector<page_t>;
+
 struct font_t
 {
     std::string name;
@@ -140,34 +376,36 @@ struct font_t
     ImFont* imfont; ///< Actual font with its settings (apart from #color)
 };
 
-extern bool obtain_image (std::string const& file, image_t& img);
-
 //--------------------------------------------------------------------------------------------------
 
 /// Most important stuff for the current running instance
 struct journal_t
 {
     bool show_titlebar;
+    bool compact_books;     ///< Save JSON books without indentation
+    bool binary_default;    ///< Keep the default book as *.jbook instead of JSON
+    struct {
+        bool enabled;
+        int window;         ///< Pages on each side of the shown ones, never shelved
+        int budget;         ///< MB of not shelved text allowed beyond the window
+    } shelf;                ///< @see shelve_pages
+    int history_budget;     ///< MB of undo steps kept (@see undo_edits)
+    int texture_budget;     ///< MB of image textures kept (@see update_textures)
     std::string background_file;
     ID3D11ShaderResourceView* background;
 
     font_t button_font, chapter_font, text_font, default_font;
 
     button_t button_prev, button_next,
-             button_settings, button_elements, button_chapters,
+             button_settings, button_elements, button_chapters, button_search,
              button_save, button_saveas, button_load;
-    bool show_settings, show_elements, show_chapters, show_saveas, show_load;
+    bool show_settings, show_elements, show_chapters, show_search, show_saveas, show_load;
 
     std::vector<variable_t> variables;
 
-    struct image_source_t {
-        unsigned refcount;
-        std::string file;
-    };
-    /// Kinda garbage collection, allows sharing of textures across the book
-    std::map<ID3D11ShaderResourceView*, image_source_t> images;
-
-    std::vector<page_t> pages;
+    /// Goes after #pages, as these may be still allocated from it
+    std::unique_ptr<text_store_t> texts;
+    page_list_t pages;
     unsigned current_page;
 };
 
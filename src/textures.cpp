@@ -0,0 +1,294 @@
+/**
+ * @file textures.cpp
+ * @brief Loading and caching of the page image textures
+ * @internal
+ *
+ * This file is part of Skyrim SE Journal mod (aka Journal).
+ *
+ *   Journal is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Journal is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Journal. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Core
+ *
+ * @details
+ * The pages share one texture per image file, found by the file path. A texture no
+ * page holds is not released right away, but kept in the cache for when the pages showing it come
+ * back. While the estimated video memory of all textures is over the budget, the least recently
+ * released of these are evicted. The textures held by pages are never evicted, so the budget can
+ * be exceeded by the pages around the shown ones.
+ *
+ * The files are read and checked on worker threads, only the texture creation is done on the
+ * render thread. A file which can not be loaded is not tried again, unless assigned anew, while
+ * the page keeps it - the cache never changes the book. The reads of images no longer near the
+ * shown pages are abandoned, their data dropped as soon as the worker finishes.
+ */
+
+#include "sse-journal.hpp"
+#include <utils/dds.hpp>
+#include <chrono>
+#include <future>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+
+//--------------------------------------------------------------------------------------------------
+
+namespace {
+
+struct texture_t
+{
+    ID3D11ShaderResourceView* ref;
+    std::size_t bytes;          ///< Estimated from the file
+    unsigned refcount;          ///< Pages holding it, if none it is only cached
+    std::list<std::string const*>::iterator unused;     ///< Valid while only cached
+};
+
+struct
+{
+    std::unordered_map<std::string, texture_t> textures;
+    std::list<std::string const*> unused;   ///< Of the cached only, least recently released first
+    std::unordered_set<std::string> failed; ///< Unable to load, not to be read again each frame
+    std::size_t bytes = 0;
+    std::size_t hits = 0, misses = 0, evictions = 0;
+}
+cache;
+
+/// Image files being read and checked by a worker
+std::unordered_map<std::string, std::future<dds_t>> loading;
+
+/// Reads no longer needed, as the destructor of an async future waits for it to finish
+std::list<std::future<dds_t>> abandoned;
+
+enum texture_status { texture_ready, texture_pending, texture_failed };
+
+void
+evict ()
+{
+    std::size_t budget = std::size_t (std::max (journal.texture_budget, 0)) << 20;
+    while (cache.bytes > budget && !cache.unused.empty ())
+    {
+        auto it = cache.textures.find (*cache.unused.front ());
+        it->second.ref->Release ();
+        cache.bytes -= it->second.bytes;
+        cache.textures.erase (it);
+        cache.unused.pop_front ();
+        ++cache.evictions;
+    }
+}
+
+/// On the render thread, with the rest of the device calls, null if unable to
+ID3D11ShaderResourceView*
+create_texture (dds_t const& dds)
+{
+    ID3D11Device* device = nullptr;
+    if (!journal.background)
+        return nullptr;
+    journal.background->GetDevice (&device);
+    if (!device)
+        return nullptr;
+
+    D3D11_TEXTURE2D_DESC desc = {};
+    desc.Width = dds.width;
+    desc.Height = dds.height;
+    desc.MipLevels = UINT (dds.levels.size ());
+    desc.ArraySize = 1;
+    desc.Format = DXGI_FORMAT (dds.format);
+    desc.SampleDesc.Count = 1;
+    desc.Usage = D3D11_USAGE_IMMUTABLE;
+    desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+    std::vector<D3D11_SUBRESOURCE_DATA> data;
+    for (auto const& l: dds.levels)
+        data.push_back ({ dds.bytes.data () + l.offset, UINT (l.row_pitch), UINT (l.slice_pitch) });
+
+    ID3D11Texture2D* texture = nullptr;
+    ID3D11ShaderResourceView* view = nullptr;
+    if (SUCCEEDED (device->CreateTexture2D (&desc, data.data (), &texture)))
+    {
+        device->CreateShaderResourceView (texture, nullptr, &view);
+        texture->Release ();
+    }
+    device->Release ();
+    return view;
+}
+
+/**
+ * The texture of the image file, shared with all other pages showing it. The file is read on a
+ * worker thread, so this is to be asked again on the next frames until no longer pending.
+ */
+
+texture_status
+load_texture (image_t& img)
+{
+    auto it = cache.textures.find (img.file);
+    bool hit = it != cache.textures.end ();
+    if (hit)
+        ++cache.hits;
+    else if (cache.failed.count (img.file))
+        return texture_failed;
+    else
+    {
+        auto job = loading.find (img.file);
+        if (job == loading.end ())
+        {
+            ++cache.misses;
+            loading.emplace (img.file, std::async (std::launch::async, [file = img.file] {
+                dds_t dds;
+                read_dds (file, dds);
+                return dds;
+            }));
+            return texture_pending;
+        }
+        if (job->second.wait_for (std::chrono::seconds (0)) != std::future_status::ready)
+            return texture_pending;
+
+        ID3D11ShaderResourceView* ref = nullptr;
+        std::size_t bytes = 0;
+        try
+        {
+            auto dds = job->second.get ();
+            bytes = dds.bytes.size ();
+            if (!dds.levels.empty ())
+                ref = create_texture (dds);
+            // Not covered or refused by the device, the SSE ImGui loader may know better
+            if (!ref && !sseimgui.ddsfile_texture (img.file.c_str (), nullptr, &ref))
+                ref = nullptr;
+        }
+        catch (std::exception const& ex)
+        {
+            log () << "Unable to read " << img.file << ": " << ex.what () << std::endl;
+        }
+        loading.erase (job);
+        if (!ref)
+        {
+            log () << "Unable to load image " << img.file << std::endl;
+            cache.failed.insert (img.file);
+            return texture_failed;
+        }
+        it = cache.textures.emplace (img.file, texture_t { ref, bytes, 0, {} }).first;
+        cache.bytes += bytes;
+    }
+
+    auto& t = it->second;
+    if (!t.refcount++ && hit)
+        cache.unused.erase (t.unused);
+    img.ref = t.ref;
+    evict ();
+    return texture_ready;
+}
+
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void
+release_image (image_t& img)
+{
+    if (!img.ref)
+        return;
+    img.ref = nullptr;
+    auto it = cache.textures.find (img.file);
+    if (it == cache.textures.end () || !it->second.refcount)
+        return;
+    auto& t = it->second;
+    if (!--t.refcount)
+        t.unused = cache.unused.insert (cache.unused.end (), &it->first);
+    evict ();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void
+assign_image (std::string const& file, image_t& img)
+{
+    if (img.file == file)
+        return;
+    release_image (img);
+    img.file = file;
+    cache.failed.erase (file); // Chosen again, maybe fixed meanwhile
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Creates the textures of the images on the shown pages and a spread on each side, so that the
+ * page turns do not wait for them, and abandons the reads of any other. The textures farther away
+ * are released, in a pass over the book done only once the shown pages change.
+ */
+
+void
+update_textures ()
+{
+    // Not near & far, these are macros of the Windows headers
+    constexpr std::size_t preload = 2, keep = 8;
+    static std::size_t shown = ~std::size_t (0);
+    static std::uint64_t version = ~std::uint64_t (0);
+
+    evict (); // The budget may have been lowered
+
+    auto& pages = journal.pages;
+    std::size_t current = journal.current_page;
+    auto begin = current - std::min (current, preload);
+    auto end = std::min (pages.size (), current + 2 + preload);
+    std::vector<std::string const*> wanted;
+    for (auto it = pages.begin () + std::min (begin, end); it != pages.begin () + end; ++it)
+    {
+        auto& p = *it;
+        fetch_page (p);
+        if (p.image.ref || p.image.file.empty ())
+            continue;
+        if (load_texture (p.image) == texture_pending)
+            wanted.push_back (&p.image.file);
+    }
+
+    abandoned.remove_if ([] (auto& f) {
+        return f.wait_for (std::chrono::seconds (0)) == std::future_status::ready;
+    });
+    for (auto it = loading.begin (); it != loading.end (); )
+        if (std::any_of (wanted.begin (), wanted.end (), [&] (auto f) { return *f == it->first; }))
+            ++it;
+        else
+        {
+            abandoned.push_back (std::move (it->second));
+            it = loading.erase (it);
+        }
+
+    if (shown == current && version == pages.version ())
+        return;
+    shown = current;
+    version = pages.version ();
+
+    auto first = current - std::min (current, keep), last = current + 2 + keep;
+    std::size_t i = 0;
+    for (auto& p: pages)
+    {
+        if ((i < first || i >= last) && p.image.ref)
+            release_image (p.image);
+        ++i;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+texture_stats_t
+texture_stats ()
+{
+    auto cached = cache.unused.size ();
+    return { cache.textures.size () - cached, cached, cache.bytes,
+             cache.hits, cache.misses, cache.evictions };
+}
+
+//--------------------------------------------------------------------------------------------------
+
@@ -27,6 +27,7 @@
 
 #include "sse-journal.hpp"
 #include <sse-hooks/sse-hooks.h>
+#include <utils/search.hpp>
 
 #include <array>
 #include <vector>
@@ -124,11 +125,11 @@ struct relocation<const char*, 3> worldspace_name { 0x2f26ef8, 0x628, 0x28, 0x00
 static void
 replace_all (std::string& data, std::string const& search, std::string const& replace)
 {
-    std::size_t n = data.find (search);
+    std::size_t n = find_text (data, search);
     while (n != std::string::npos)
     {
         data.replace (n, search.size (), replace);
-        n = data.find (search, n + replace.size ());
+        n = find_text (data, search, n + replace.size ());
     }
 }
 
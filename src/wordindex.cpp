@@ -0,0 +1,538 @@
+/**
+ * @file wordindex.cpp
+ * @brief Index of the page words, for the misspelling tolerant search
+ * @internal
+ *
+ * This file is part of Skyrim SE Journal mod (aka Journal).
+ *
+ *   Journal is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Journal is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Journal. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Core
+ *
+ * @details
+ * The words of the page titles and contents, composed and folded to lower case (@see fold_utf8),
+ * each with the pages having it. The words are indexed again by their trigrams (with a space
+ * before and after the word), so that the words close to a query one are found by the trigrams
+ * they share with it. Only these are compared by their edit distance in code points, the page
+ * texts are not read at all by the queries.
+ *
+ * The pages are indexed when first asked for, for a bounded time each frame as these may have to
+ * be fetched, and then again only as they change (@see index_page). A page released back to its
+ * binary book keeps its words.
+ */
+
+#include "sse-journal.hpp"
+#include <utils/utf8.hpp>
+#include <chrono>
+#include <iterator>
+#include <unordered_map>
+
+//--------------------------------------------------------------------------------------------------
+
+namespace {
+
+/// Indexing time per frame, at least one page is done anyway
+constexpr auto frame_work = std::chrono::microseconds (2000);
+
+/// In bytes, the shorter ones are too common, the longer are not words
+constexpr std::size_t min_word = 2, max_word = 32;
+
+struct word_t
+{
+    std::string_view text;              ///< The key in the vocabulary
+    std::vector<std::uint32_t> pages;   ///< Sorted slots
+};
+
+/// Pages by their ids, as these stay while the book order changes
+struct slot_t
+{
+    std::uint32_t id;
+    std::size_t position;               ///< In the book, as of the last version seen
+    std::size_t signature;              ///< Of the indexed title and content
+    bool used, indexed;
+    bool queued;                        ///< In the todo list, kept while the slot is free
+    std::vector<std::uint32_t> words;   ///< Sorted
+};
+
+struct
+{
+    std::unordered_map<std::string, std::uint32_t> vocabulary;
+    std::vector<word_t> words;
+    std::vector<std::uint32_t> free_words;
+    std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> trigrams;   ///< To words
+
+    std::unordered_map<std::uint32_t, std::uint32_t> slot_of;
+    std::vector<slot_t> slots;
+    std::vector<std::uint32_t> free_slots;
+    std::vector<std::uint32_t> todo;    ///< Slots to index, or to check for changes, once each
+    std::size_t indexed = 0;
+
+    std::uint64_t version = ~std::uint64_t (0);     ///< Of the page list
+    std::uint64_t generation = 0;       ///< Of the words, for the queries to redo
+}
+state;
+
+struct
+{
+    fuzzy_state_t state;
+    std::uint64_t generation;
+}
+fuzzy;
+
+/// True if a word goes on, the punctuation and symbols of Latin-1, U+2000..206F and U+3000..303F
+/// break words, as do the ASCII ones
+bool
+letter (char32_t c)
+{
+    if (c < 0x80)
+        return (c >= '0' && c <= '9') || ((c | 0x20) >= 'a' && (c | 0x20) <= 'z');
+    if (c < 0xc0)
+        return c == 0xaa || c == 0xb5 || c == 0xba;
+    return c != 0xd7 && c != 0xf7 && c != 0xfffd && !is_space (c)
+        && !(c >= 0x2000 && c < 0x2070) && !(c >= 0x3000 && c < 0x3040);
+}
+
+/// Calls @p word with each word of @p text, composed and folded to lower case
+template<class Function>
+void
+for_each_word (std::string_view text, Function&& word)
+{
+    std::string w;
+    for (std::size_t i = 0, n; i < text.size (); i += n)
+    {
+        char32_t c;
+        if ((text[i] & 0x80) || (i + 1 < text.size () && (text[i + 1] & 0x80)))
+            n = utf8_decode_nfc (text, i, c);
+        else
+            n = 1, c = char32_t (text[i]);
+        if (letter (c))
+        {
+            if (c < 0x80)
+                w += (c >= 'A' && c <= 'Z') ? char (c | 0x20) : char (c);
+            else
+                utf8_append (w, fold_case (c));
+        }
+        else if (!w.empty ())
+        {
+            if (w.size () >= min_word && w.size () <= max_word)
+                word (w);
+            w.clear ();
+        }
+    }
+    if (w.size () >= min_word && w.size () <= max_word)
+        word (w);
+}
+
+/// Code points of a word, up to max_word of them
+std::size_t
+decode_word (std::string_view word, char32_t* out)
+{
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < word.size () && n < max_word; ++n)
+        i += utf8_decode (word, i, out[n]);
+    return n;
+}
+
+template<class Function>
+void
+for_each_trigram (std::string_view word, Function&& trigram)
+{
+    auto at = [word] (std::size_t i) -> std::uint32_t {
+        return i && i <= word.size () ? std::uint8_t (word[i - 1]) : ' ';
+    };
+    for (std::size_t i = 0; i < word.size (); ++i)
+        trigram (at (i) << 16 | at (i + 1) << 8 | at (i + 2));
+}
+
+/// Levenshtein distance of the code points, or k + 1 if more than @p k
+unsigned
+distance (std::u32string_view a, std::string_view word, unsigned k)
+{
+    char32_t buffer[max_word];
+    std::u32string_view b (buffer, decode_word (word, buffer));
+    if (a.size () > b.size ())
+        std::swap (a, b);
+    if (b.size () - a.size () > k)
+        return k + 1;
+    unsigned row[max_word + 1];
+    for (unsigned j = 0; j <= a.size (); ++j)
+        row[j] = j;
+    for (unsigned i = 1; i <= b.size (); ++i)
+    {
+        unsigned diag = row[0], best = row[0] = i;
+        for (unsigned j = 1; j <= a.size (); ++j)
+        {
+            unsigned up = row[j];
+            row[j] = std::min (std::min (up, row[j - 1]) + 1, diag + (a[j - 1] != b[i - 1]));
+            diag = up;
+            best = std::min (best, row[j]);
+        }
+        if (best > k)
+            return k + 1;
+    }
+    return std::min (row[a.size ()], k + 1);
+}
+
+/// Edits allowed for a query word of @p n code points
+unsigned
+allowed (std::size_t n)
+{
+    return n < 4 ? 0 : n < 8 ? 1 : 2;
+}
+
+std::uint32_t
+add_word (std::string const& text)
+{
+    auto it = state.vocabulary.find (text);
+    if (it != state.vocabulary.end ())
+        return it->second;
+    it = state.vocabulary.emplace (text, 0).first;
+    std::uint32_t w;
+    if (state.free_words.empty ())
+    {
+        w = std::uint32_t (state.words.size ());
+        state.words.emplace_back ();
+    }
+    else
+    {
+        w = state.free_words.back ();
+        state.free_words.pop_back ();
+    }
+    it->second = w;
+    state.words[w].text = it->first;
+    for_each_trigram (it->first, [w] (std::uint32_t t) { state.trigrams[t].push_back (w); });
+    return w;
+}
+
+void
+drop_word (std::uint32_t w)
+{
+    auto text = state.words[w].text;
+    for_each_trigram (text, [w] (std::uint32_t t) {
+        auto it = state.trigrams.find (t);
+        auto& ws = it->second;
+        auto at = std::find (ws.begin (), ws.end (), w);
+        if (at != ws.end ())
+        {
+            *at = ws.back ();
+            ws.pop_back ();
+        }
+        if (ws.empty ())
+            state.trigrams.erase (it);
+    });
+    state.words[w] = word_t {};
+    state.free_words.push_back (w);
+    state.vocabulary.erase (std::string (text));
+}
+
+/// Moves the page @p s from its old words to @p fresh, both sorted
+void
+set_words (std::uint32_t s, std::vector<std::uint32_t> fresh)
+{
+    auto& old = state.slots[s].words;
+    std::vector<std::uint32_t> gone, added;
+    std::set_difference (old.begin (), old.end (), fresh.begin (), fresh.end (),
+            std::back_inserter (gone));
+    std::set_difference (fresh.begin (), fresh.end (), old.begin (), old.end (),
+            std::back_inserter (added));
+    old = std::move (fresh);
+
+    for (auto w: added)
+    {
+        auto& pages = state.words[w].pages;
+        pages.insert (std::lower_bound (pages.begin (), pages.end (), s), s);
+    }
+    for (auto w: gone)
+    {
+        auto& pages = state.words[w].pages;
+        auto at = std::lower_bound (pages.begin (), pages.end (), s);
+        if (at != pages.end () && *at == s)
+            pages.erase (at);
+        if (pages.empty ())
+            drop_word (w);
+    }
+    if (!gone.empty () || !added.empty ())
+        ++state.generation;
+}
+
+void
+index_slot (std::uint32_t s)
+{
+    auto& slot = state.slots[s];
+    if (!slot.used)
+        return;
+    auto& page = journal.pages[slot.position];
+    if (!page.loaded && slot.indexed)
+        return; // Released, the words are as they were
+    if (!fetch_page (page))
+        return;
+
+    std::hash<std::string_view> hash;
+    auto signature = hash (page.title) * 31 + hash (page.content);
+    if (slot.indexed && slot.signature == signature)
+        return;
+
+    std::vector<std::uint32_t> fresh;
+    auto add = [&fresh] (std::string const& w) { fresh.push_back (add_word (w)); };
+    for_each_word (page.title, add);
+    for_each_word (page.content, add);
+    std::sort (fresh.begin (), fresh.end ());
+    fresh.erase (std::unique (fresh.begin (), fresh.end ()), fresh.end ());
+    set_words (s, std::move (fresh));
+
+    slot.signature = signature;
+    if (!slot.indexed)
+    {
+        slot.indexed = true;
+        ++state.indexed;
+    }
+}
+
+void
+queue_slot (std::uint32_t s)
+{
+    if (!std::exchange (state.slots[s].queued, true))
+        state.todo.push_back (s);
+}
+
+/// New slots for the new pages, the erased ones drop their words
+void
+follow_pages ()
+{
+    if (state.version == journal.pages.version ())
+        return;
+    state.version = journal.pages.version ();
+
+    std::vector<bool> seen (state.slots.size ());
+    std::size_t i = 0;
+    for (auto const& p: journal.pages)
+    {
+        auto [it, added] = state.slot_of.emplace (p.id, 0);
+        if (added)
+        {
+            if (state.free_slots.empty ())
+            {
+                it->second = std::uint32_t (state.slots.size ());
+                state.slots.emplace_back ();
+            }
+            else
+            {
+                it->second = state.free_slots.back ();
+                state.free_slots.pop_back ();
+            }
+            auto& slot = state.slots[it->second];
+            slot = slot_t { p.id, i, 0, true, false, slot.queued, {} };
+            queue_slot (it->second);
+        }
+        if (it->second < seen.size ())
+            seen[it->second] = true;
+        state.slots[it->second].position = i++;
+    }
+
+    for (std::uint32_t s = 0; s < seen.size (); ++s)
+        if (state.slots[s].used && !seen[s])
+        {
+            set_words (s, {});
+            auto& slot = state.slots[s];
+            state.indexed -= slot.indexed;
+            state.slot_of.erase (slot.id);
+            slot = slot_t { 0, 0, 0, false, false, slot.queued, {} };
+            state.free_slots.push_back (s);
+        }
+    ++state.generation;
+}
+
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void
+reindex_words (page_t const& page)
+{
+    auto it = state.slot_of.find (page.id);
+    if (it != state.slot_of.end ())
+        queue_slot (it->second);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool
+update_word_index (bool bounded)
+{
+    follow_pages ();
+    auto& todo = state.todo;
+    auto deadline = std::chrono::steady_clock::now () + frame_work;
+    std::size_t done = 0;
+    while (done < todo.size ())
+    {
+        auto s = todo[done++];
+        state.slots[s].queued = false;
+        index_slot (s);
+        if (bounded && std::chrono::steady_clock::now () > deadline)
+            break;
+    }
+    todo.erase (todo.begin (), todo.begin () + done);
+    return todo.empty ();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Each query word is matched to the indexed words within its allowed edits, these sharing enough
+ * trigrams with it are the only ones compared. The pages score the best match of each query word,
+ * one for the exact word, less for each edit.
+ */
+
+std::vector<word_hit_t>
+find_words (std::string_view query, std::size_t max_hits)
+{
+    follow_pages ();
+
+    struct match_t { unsigned edits; std::uint32_t word; };
+    std::vector<std::string> terms;
+    for_each_word (query, [&terms] (std::string const& w) { terms.push_back (w); });
+    std::vector<std::vector<match_t>> matches (terms.size ());
+    std::vector<std::size_t> lengths (terms.size ());
+
+    static std::vector<std::uint16_t> shared;
+    std::vector<std::uint32_t> touched;
+    shared.resize (state.words.size ());
+    for (std::size_t j = 0; j < terms.size (); ++j)
+    {
+        auto const& term = terms[j];
+        char32_t buffer[max_word];
+        std::u32string_view points (buffer, decode_word (term, buffer));
+        auto k = allowed (lengths[j] = points.size ());
+        if (!k)
+        {
+            auto it = state.vocabulary.find (term);
+            if (it != state.vocabulary.end ())
+                matches[j].push_back ({ 0, it->second });
+            continue;
+        }
+
+        // An edit spoils the trigrams with any byte of the code point, and the two before it
+        std::size_t trigrams = 0, spoiled = 2 + (term.size () > points.size () ? 4 : 1);
+        for_each_trigram (term, [&] (std::uint32_t t) {
+            ++trigrams;
+            auto it = state.trigrams.find (t);
+            if (it != state.trigrams.end ())
+                for (auto w: it->second)
+                    if (!shared[w]++)
+                        touched.push_back (w);
+        });
+        std::size_t least = trigrams > spoiled * k ? trigrams - spoiled * k : 1;
+        for (auto w: touched)
+        {
+            if (shared[w] >= least)
+            {
+                auto edits = distance (points, state.words[w].text, k);
+                if (edits <= k)
+                    matches[j].push_back ({ edits, w });
+            }
+            shared[w] = 0;
+        }
+        touched.clear ();
+        std::sort (matches[j].begin (), matches[j].end (), [] (auto const& a, auto const& b) {
+            return a.edits < b.edits;
+        });
+    }
+
+    // The first (fewest edits) match of a term on a page is its best
+    static std::vector<float> score;
+    static std::vector<std::uint32_t> found, stamp;
+    score.resize (state.slots.size ());
+    found.resize (state.slots.size ());
+    stamp.resize (state.slots.size ());
+    std::vector<std::uint32_t> pages;
+    for (std::size_t j = 0; j < terms.size (); ++j)
+        for (auto const& m: matches[j])
+            for (auto s: state.words[m.word].pages)
+            {
+                if (!found[s])
+                    pages.push_back (s), score[s] = 0;
+                else if (stamp[s] == j + 1)
+                    continue;
+                stamp[s] = std::uint32_t (j + 1);
+                ++found[s];
+                score[s] += 1.f - float (m.edits) / float (lengths[j] + 1);
+            }
+
+    auto better = [] (std::uint32_t a, std::uint32_t b) {
+        if (score[a] != score[b])
+            return score[a] > score[b];
+        return state.slots[a].position < state.slots[b].position;
+    };
+    auto n = std::min (max_hits, pages.size ());
+    std::partial_sort (pages.begin (), pages.begin () + n, pages.end (), better);
+
+    std::vector<word_hit_t> hits;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        auto s = pages[i];
+        word_hit_t hit { state.slots[s].position, score[s] / float (terms.size ()),
+                         terms.size () - found[s], {} };
+        for (auto const& ms: matches)
+            for (auto const& m: ms)
+            {
+                auto const& wp = state.words[m.word].pages;
+                if (!std::binary_search (wp.begin (), wp.end (), s))
+                    continue;
+                if (!hit.words.empty ())
+                    hit.words += ' ';
+                hit.words += state.words[m.word].text;
+                break;
+            }
+        hits.push_back (std::move (hit));
+    }
+    for (auto s: pages)
+        found[s] = stamp[s] = 0;
+    return hits;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void
+fuzzy_search (std::string_view query)
+{
+    if (query == fuzzy.state.query)
+        return;
+    fuzzy.state.query = query;
+    fuzzy.generation = ~std::uint64_t (0);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+fuzzy_state_t const&
+continue_fuzzy_search ()
+{
+    /// The rest are not shown anyway
+    constexpr std::size_t max_hits = 1000;
+
+    auto& st = fuzzy.state;
+    update_word_index (true);
+    if (fuzzy.generation != state.generation)
+    {
+        fuzzy.generation = state.generation;
+        st.hits = find_words (st.query, max_hits);
+    }
+    st.indexed = state.indexed;
+    st.pages = journal.pages.size ();
+    return st;
+}
+
+//--------------------------------------------------------------------------------------------------
+
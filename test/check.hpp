@@ -0,0 +1,62 @@
+/**
+ * @file check.hpp
+ * @brief Minimal checks for the unit tests, no framework needed
+ * @internal
+ *
+ * This file is part of Skyrim SE Journal mod (aka Journal).
+ *
+ *   Journal is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Journal is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Journal. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Tests
+ *
+ * @details
+ * A failed check is printed and counted, the test goes on. The program exit code is the count of
+ * the failed checks, so that waf reports the test as failed.
+ */
+
+#ifndef TEST_CHECK_HPP
+#define TEST_CHECK_HPP
+
+#include <cstdio>
+
+//--------------------------------------------------------------------------------------------------
+
+inline int check_failures = 0;
+
+inline bool
+check_report (bool ok, const char* what, const char* file, int line)
+{
+    if (!ok)
+    {
+        std::fprintf (stderr, "%s:%d: check failed: %s\n", file, line, what);
+        ++check_failures;
+    }
+    return ok;
+}
+
+#define CHECK(x) check_report (bool (x), #x, __FILE__, __LINE__)
+
+/// The expression must throw the given exception type (or a derived one)
+#define CHECK_THROWS(x, type) do {                                          \
+        bool thrown_ = false;                                               \
+        try { (void) (x); } catch (type const&) { thrown_ = true; }         \
+        check_report (thrown_, #x " throws " #type, __FILE__, __LINE__);    \
+    } while (0)
+
+//--------------------------------------------------------------------------------------------------
+
+#endif
+
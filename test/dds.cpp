@@ -0,0 +1,342 @@
+/**
+ * @file dds.cpp
+ * @brief Unit tests of the DDS parsing in share/utils/dds.cpp
+ * @internal
+ *
+ * This file is part of Skyrim SE Journal mod (aka Journal).
+ *
+ *   Journal is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Journal is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Journal. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Tests
+ *
+ * @details
+ * The files are put together in memory, header field by header field, as the tools write them.
+ */
+
+#include "check.hpp"
+#include <utils/dds.hpp>
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include <filesystem>
+#include <fstream>
+
+//--------------------------------------------------------------------------------------------------
+
+namespace {
+
+constexpr std::uint32_t flag_mips = 0x20000;
+constexpr std::uint32_t pf_alpha = 0x1, pf_fourcc = 0x4, pf_rgb = 0x40;
+constexpr std::uint32_t caps2_cubemap = 0x200;
+
+constexpr std::uint32_t fourcc (const char (&s)[5])
+{
+    return std::uint32_t (s[0]) | std::uint32_t (s[1]) << 8 | std::uint32_t (s[2]) << 16
+        | std::uint32_t (s[3]) << 24;
+}
+
+struct dds_file_t
+{
+    std::uint32_t width = 4, height = 4, flags = 0x1007, mips = 0;
+    std::uint32_t pf_flags = pf_fourcc, code = fourcc ("DXT1"), pf_bits = 0;
+    std::uint32_t masks[4] = {};
+    std::uint32_t caps2 = 0;
+    bool dx10 = false;
+    std::uint32_t dx10_format = 0, dx10_dimension = 3, dx10_misc = 0, dx10_array = 1;
+    std::size_t data = 0;       ///< Bytes of image data after the headers
+
+    std::string bytes () const
+    {
+        std::vector<std::uint32_t> w;
+        w.push_back (fourcc ("DDS "));
+        w.insert (w.end (), { 124, flags, height, width, 0, 0, mips });
+        w.insert (w.end (), 11, 0);
+        w.insert (w.end (), { 32, pf_flags, code, pf_bits });
+        w.insert (w.end (), std::begin (masks), std::end (masks));
+        w.insert (w.end (), { 0x1000, caps2, 0, 0, 0 });
+        if (dx10)
+            w.insert (w.end (), { dx10_format, dx10_dimension, dx10_misc, dx10_array, 0 });
+        std::string s (reinterpret_cast<const char*> (w.data ()), w.size () * 4);
+        s.append (data, '\x5a');
+        return s;
+    }
+};
+
+constexpr std::size_t header = 4 + 124, header_dx10 = header + 20;
+
+//--------------------------------------------------------------------------------------------------
+
+void
+dxt1_mips ()
+{
+    dds_file_t f;
+    f.width = 64;
+    f.height = 32;
+    f.flags |= flag_mips;
+    f.mips = 7;
+    f.data = 1024 + 256 + 64 + 16 + 8 + 8 + 8;
+
+    dds_t dds;
+    CHECK (parse_dds (f.bytes (), dds));
+    CHECK (dds.width == 64 && dds.height == 32);
+    CHECK (dds.format == 71);
+    CHECK (dds.bytes.size () == header + f.data);
+    if (!CHECK (dds.levels.size () == 7))
+        return;
+
+    // The blocks of the smallest levels are still whole 4x4 blocks
+    const std::size_t rows[] = { 128, 64, 32, 16, 8, 8, 8 };
+    const std::size_t slices[] = { 1024, 256, 64, 16, 8, 8, 8 };
+    std::size_t offset = header;
+    for (std::size_t i = 0; i < 7; ++i)
+    {
+        CHECK (dds.levels[i].offset == offset);
+        CHECK (dds.levels[i].row_pitch == rows[i]);
+        CHECK (dds.levels[i].slice_pitch == slices[i]);
+        offset += slices[i];
+    }
+}
+
+void
+dxt5 ()
+{
+    dds_file_t f;
+    f.width = 16;
+    f.height = 16;
+    f.code = fourcc ("DXT5");
+    f.data = 256;
+
+    dds_t dds;
+    CHECK (parse_dds (f.bytes (), dds));
+    CHECK (dds.format == 77);
+    if (CHECK (dds.levels.size () == 1))
+    {
+        CHECK (dds.levels[0].offset == header);
+        CHECK (dds.levels[0].row_pitch == 64);
+        CHECK (dds.levels[0].slice_pitch == 256);
+    }
+}
+
+void
+rgba8 ()
+{
+    dds_file_t f;
+    f.width = 3;
+    f.height = 2;
+    f.pf_flags = pf_rgb | pf_alpha;
+    f.code = 0;
+    f.pf_bits = 32;
+    f.masks[0] = 0xff;
+    f.masks[1] = 0xff00;
+    f.masks[2] = 0xff0000;
+    f.masks[3] = 0xff000000;
+    f.data = 24;
+
+    dds_t dds;
+    CHECK (parse_dds (f.bytes (), dds));
+    CHECK (dds.format == 28);
+    if (CHECK (dds.levels.size () == 1))
+    {
+        CHECK (dds.levels[0].row_pitch == 12);
+        CHECK (dds.levels[0].slice_pitch == 24);
+    }
+
+    // Same masks, but the blue and red swapped
+    std::swap (f.masks[0], f.masks[2]);
+    CHECK (parse_dds (f.bytes (), dds));
+    CHECK (dds.format == 87);
+}
+
+void
+dx10_bc7 ()
+{
+    dds_file_t f;
+    f.width = 8;
+    f.height = 8;
+    f.flags |= flag_mips;
+    f.mips = 4;
+    f.code = fourcc ("DX10");
+    f.dx10 = true;
+    f.dx10_format = 98;
+    f.data = 64 + 16 + 16 + 16;
+
+    dds_t dds;
+    CHECK (parse_dds (f.bytes (), dds));
+    CHECK (dds.format == 98);
+    if (CHECK (dds.levels.size () == 4))
+    {
+        CHECK (dds.levels[0].offset == header_dx10);
+        CHECK (dds.levels[0].row_pitch == 32);
+        CHECK (dds.levels[0].slice_pitch == 64);
+        CHECK (dds.levels[3].offset == header_dx10 + 64 + 16 + 16);
+        CHECK (dds.levels[3].slice_pitch == 16);
+    }
+}
+
+void
+truncated ()
+{
+    dds_t dds;
+    CHECK_THROWS (parse_dds (std::string (), dds), std::runtime_error);
+    CHECK_THROWS (parse_dds (dds_file_t {}.bytes ().substr (0, 100), dds), std::runtime_error);
+
+    dds_file_t f;
+    f.width = 64;
+    f.height = 32;
+    f.flags |= flag_mips;
+    f.mips = 7;
+    f.data = 1384 - 1;
+    CHECK_THROWS (parse_dds (f.bytes (), dds), std::runtime_error);
+
+    // The mip levels are not all there, even though the first one is
+    f.data = 1024 + 1;
+    CHECK_THROWS (parse_dds (f.bytes (), dds), std::runtime_error);
+
+    dds_file_t x;
+    x.code = fourcc ("DX10");
+    x.dx10 = true;
+    x.dx10_format = 98;
+    CHECK_THROWS (parse_dds (x.bytes ().substr (0, header + 10), dds), std::runtime_error);
+}
+
+void
+too_many_mips ()
+{
+    dds_file_t f;
+    f.flags |= flag_mips;
+    f.mips = 4;     // 4x4, 2x2, 1x1 at most
+    f.data = 1024;
+
+    dds_t dds;
+    CHECK_THROWS (parse_dds (f.bytes (), dds), std::runtime_error);
+
+    f.mips = 3;
+    CHECK (parse_dds (f.bytes (), dds));
+    CHECK (dds.levels.size () == 3);
+
+    // The mips count is ignored without its flag
+    f.flags &= ~flag_mips;
+    f.mips = 100;
+    CHECK (parse_dds (f.bytes (), dds));
+    CHECK (dds.levels.size () == 1);
+}
+
+void
+junk ()
+{
+    dds_t dds;
+    std::string s (500, '\0');
+    for (std::size_t i = 0; i < s.size (); ++i)
+        s[i] = char (i * 7919 % 251);
+    CHECK_THROWS (parse_dds (s, dds), std::runtime_error);
+
+    // Right magic, but the header size is not
+    auto bytes = dds_file_t {}.bytes ();
+    bytes[4] = 100;
+    CHECK_THROWS (parse_dds (bytes, dds), std::runtime_error);
+
+    dds_file_t f;
+    f.data = 8;
+    f.width = 0;
+    CHECK_THROWS (parse_dds (f.bytes (), dds), std::runtime_error);
+    f.width = 32768;
+    CHECK_THROWS (parse_dds (f.bytes (), dds), std::runtime_error);
+}
+
+void
+not_covered ()
+{
+    dds_t dds;
+    dds_file_t f;
+    f.data = 8 * 6;
+
+    f.caps2 = caps2_cubemap;
+    auto bytes = f.bytes ();
+    CHECK (!parse_dds (bytes, dds));
+    CHECK (dds.levels.empty ());
+    CHECK (dds.bytes == bytes);
+
+    f.caps2 = 0;
+    f.code = fourcc ("BC6H");
+    CHECK (!parse_dds (f.bytes (), dds));
+    CHECK (dds.levels.empty ());
+
+    dds_file_t x;
+    x.code = fourcc ("DX10");
+    x.dx10 = true;
+    x.dx10_format = 98;
+    x.data = 16 * 2;
+    x.dx10_array = 2;
+    CHECK (!parse_dds (x.bytes (), dds));
+    x.dx10_array = 1;
+    x.dx10_dimension = 4;   // 3D
+    CHECK (!parse_dds (x.bytes (), dds));
+    x.dx10_dimension = 3;
+    x.dx10_format = 1;      // Typeless, no size known
+    CHECK (!parse_dds (x.bytes (), dds));
+    CHECK (dds.levels.empty ());
+
+    // The levels of an earlier parse are not kept
+    x.dx10_format = 98;
+    CHECK (parse_dds (x.bytes (), dds));
+    CHECK (dds.levels.size () == 1);
+    x.dx10_misc = 0x4;
+    CHECK (!parse_dds (x.bytes (), dds));
+    CHECK (dds.levels.empty ());
+}
+
+void
+from_file ()
+{
+    dds_file_t f;
+    f.code = fourcc ("DXT5");
+    f.data = 16;
+    auto path = std::filesystem::temp_directory_path () / "sse-journal-test.dds";
+    {
+        std::ofstream of (path, std::ios::binary);
+        of << f.bytes ();
+    }
+    dds_t dds;
+    CHECK (read_dds (path.string (), dds));
+    CHECK (dds.format == 77 && dds.levels.size () == 1);
+    std::filesystem::remove (path);
+
+    CHECK_THROWS (read_dds (path.string (), dds), std::runtime_error);
+}
+
+}
+
+//--------------------------------------------------------------------------------------------------
+
+int
+main ()
+{
+    dxt1_mips ();
+    dxt5 ();
+    rgba8 ();
+    dx10_bc7 ();
+    truncated ();
+    too_many_mips ();
+    junk ();
+    not_covered ();
+    from_file ();
+    return check_failures;
+}
+
+//--------------------------------------------------------------------------------------------------
+
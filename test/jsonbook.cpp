@@ -0,0 +1,118 @@
+/**
+ * @file jsonbook.cpp
+ * @brief Unit tests of the SAX book loading in share/utils/jsonbook.hpp
+ * @internal
+ *
+ * This file is part of Skyrim SE Journal mod (aka Journal).
+ *
+ *   Journal is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Journal is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Journal. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Tests
+ */
+
+#include "check.hpp"
+#include <utils/jsonbook.hpp>
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <filesystem>
+#include <fstream>
+#include <memory_resource>
+
+//--------------------------------------------------------------------------------------------------
+
+namespace {
+
+struct page_t
+{
+    std::string title, content;
+    struct
+    {
+        bool background;
+        unsigned tint;
+        std::array<float, 4> uv, xy;
+    }
+    image {};
+
+    explicit page_t (std::pmr::memory_resource*) {}
+};
+
+/// Parses the given JSON book, @p ok tells whether it was of the major version one
+json_book_sax<page_t>
+parse (std::string_view json, bool& ok)
+{
+    auto path = std::filesystem::temp_directory_path () / "sse-journal-test.json";
+    {
+        std::ofstream of (path, std::ios::binary);
+        of << json;
+    }
+    json_book_sax<page_t> sax (std::pmr::new_delete_resource ());
+    {
+        mapped_file file (path.string ());
+        ok = parse_json_book (file, nlohmann::detail::input_format_t::json, 1, sax);
+    }
+    std::filesystem::remove (path);
+    return sax;
+}
+
+void
+pages_in_order ()
+{
+    bool ok;
+    auto sax = parse (R"({ "version": { "major": 1 }, "current": 1, "pages": {
+            "2": { "title": "B" }, "1": { "title": "A", "content": "a" } } })", ok);
+    CHECK (ok && sax.current == 1 && sax.pages.size () == 2);
+    CHECK (sax.pages[0].page.title == "A" && sax.pages[0].page.content == "a");
+    CHECK (sax.pages[1].page.title == "B");
+}
+
+void
+bogus_numbers ()
+{
+    // Past any page, the loader falls back to the first one then
+    for (auto current: { "-1", "2.5", "1e20", "4294967296" })
+    {
+        bool ok;
+        auto sax = parse (std::string (R"({ "version": { "major": 1 }, "current": )")
+                + current + " }", ok);
+        CHECK (ok && sax.current == 4294967295u);
+    }
+    bool ok;
+    CHECK (parse (R"({ "current": 4294967294, "version": { "major": 1 } })", ok).current
+            == 4294967294u && ok);
+
+    // Not of any version then
+    for (auto major: { "-1", "1.5", "4294967297" })
+    {
+        parse (std::string (R"({ "version": { "major": )") + major + " } }", ok);
+        CHECK (!ok);
+    }
+}
+
+}
+
+//--------------------------------------------------------------------------------------------------
+
+int
+main ()
+{
+    pages_in_order ();
+    bogus_numbers ();
+    return check_failures;
+}
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,102 @@
+/**
+ * @file takenotes.cpp
+ * @brief Unit tests of the Take Notes (FISS XML) page bucketing in share/utils/takenotes.cpp
+ * @internal
+ *
+ * This file is part of Skyrim SE Journal mod (aka Journal).
+ *
+ *   Journal is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Journal is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Journal. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Tests
+ */
+
+#include "check.hpp"
+#include <utils/takenotes.hpp>
+
+#include <string>
+#include <vector>
+#include <string_view>
+#include <stdexcept>
+#include <filesystem>
+#include <fstream>
+
+//--------------------------------------------------------------------------------------------------
+
+namespace {
+
+/// The pages of a FISS file with the given count and /fiss/Data nodes, "title|content" each
+std::vector<std::string>
+pages (std::string_view count, std::string_view nodes)
+{
+    auto path = std::filesystem::temp_directory_path () / "sse-journal-test.xml";
+    {
+        std::ofstream of (path, std::ios::binary);
+        of << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<fiss><Data><NumberOfEntries>" << count
+           << "</NumberOfEntries>" << nodes << "</Data></fiss>\n";
+    }
+    std::vector<std::string> out;
+    {
+        mapped_file file (path.string ());
+        std::string copy;
+        rapidxml::xml_document<> doc;
+        for (auto [title, entry]: takenotes_pages (file, copy, doc))
+            out.push_back (title && entry ? std::string (title->value (), title->value_size ())
+                    + '|' + std::string (entry->value (), entry->value_size ()) : "");
+    }
+    std::filesystem::remove (path);
+    return out;
+}
+
+void
+in_order ()
+{
+    auto p = pages ("2", "<date1>A</date1><entry1>a</entry1><date2>B</date2><entry2>b</entry2>");
+    CHECK (p.size () == 2 && p[0] == "A|a" && p[1] == "B|b");
+}
+
+void
+shuffled_with_holes ()
+{
+    auto p = pages ("3", "<entry3>c</entry3><date2>B</date2><date3>C</date3><date1>A</date1>"
+            "<entry1>a</entry1><date1>Duplicate</date1><entry9>past the count</entry9>");
+    CHECK (p.size () == 3 && p[0] == "A|a" && p[1].empty () && p[2] == "C|c");
+}
+
+void
+bogus_count ()
+{
+    // Bounded by the nodes, not allocated as told
+    auto p = pages ("4294967297", "<date1>A</date1><entry1>a</entry1>");
+    CHECK (p.size () == 3 && p[0] == "A|a");
+    CHECK (pages (" 1\n", "<date1>A</date1><entry1>a</entry1>").size () == 1);
+    CHECK_THROWS (pages ("-1", ""), std::runtime_error);
+    CHECK_THROWS (pages ("many", ""), std::runtime_error);
+}
+
+}
+
+//--------------------------------------------------------------------------------------------------
+
+int
+main ()
+{
+    in_order ();
+    shuffled_with_holes ();
+    bogus_count ();
+    return check_failures;
+}
+
+//--------------------------------------------------------------------------------------------------
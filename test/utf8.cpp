@@ -0,0 +1,116 @@
+/**
+ * @file utf8.cpp
+ * @brief Unit tests of the UTF-8 decoding, composition and folding in share/utils/utf8.cpp
+ * @internal
+ *
+ * This file is part of Skyrim SE Journal mod (aka Journal).
+ *
+ *   Journal is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Journal is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Journal. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Tests
+ *
+ * @details
+ * The strings are written with the escapes, so that the decomposed forms stay as they are.
+ */
+
+#include "check.hpp"
+#include <utils/utf8.hpp>
+#include <utils/search.hpp>
+
+#include <string>
+
+//--------------------------------------------------------------------------------------------------
+
+
+namespace {
+
+void
+decode ()
+{
+    char32_t cp;
+    CHECK (utf8_decode ("A", 0, cp) == 1 && cp == 'A');
+    CHECK (utf8_decode ("\u00e9", 0, cp) == 2 && cp == 0xe9);
+    CHECK (utf8_decode ("\u20ac", 0, cp) == 3 && cp == 0x20ac);
+    CHECK (utf8_decode ("\U0001f409", 0, cp) == 4 && cp == 0x1f409);
+    CHECK (utf8_decode ("\xc0\xaf", 0, cp) == 1 && cp == 0xfffd);       // Overlong
+    CHECK (utf8_decode ("\xed\xa0\x80", 0, cp) == 1 && cp == 0xfffd);   // Surrogate
+    CHECK (utf8_decode ("\xe2\x82", 0, cp) == 1 && cp == 0xfffd);       // Truncated
+
+    std::string s;
+    for (char32_t c: { 0x41u, 0xe9u, 0x20acu, 0x1f409u })
+        utf8_append (s, c);
+    CHECK (s == "A\u00e9\u20ac\U0001f409");
+}
+
+void
+compose ()
+{
+    CHECK (utf8_compose ('e', 0x301) == 0xe9);
+    CHECK (utf8_compose ('A', 0x30a) == 0xc5);
+    CHECK (utf8_compose (0x438, 0x306) == 0x439);
+    CHECK (utf8_compose (0x415, 0x308) == 0x401);
+    CHECK (utf8_compose ('q', 0x301) == 0);
+    CHECK (utf8_compose ('e', 'e') == 0);
+
+    char32_t cp;
+    CHECK (utf8_decode_nfc ("e\u0301t", 0, cp) == 3 && cp == 0xe9);
+    CHECK (utf8_decode_nfc ("e\u0323\u0302", 0, cp) == 5 && cp == 0x1ec7);
+    CHECK (utf8_decode_nfc ("q\u0301", 0, cp) == 1 && cp == 'q');
+    CHECK (utf8_decode_nfc ("\u0301", 0, cp) == 2 && cp == 0x301);
+    CHECK (utf8_decode_nfc ("e\xcc", 0, cp) == 1 && cp == 'e');
+}
+
+void
+fold ()
+{
+    CHECK (fold_case ('A') == 'a' && fold_case (0xc9) == 0xe9 && fold_case (0x416) == 0x436);
+    CHECK (fold_case (0x1f409) == 0x1f409);
+    CHECK (fold_utf8 ("Hello, W\u00d6RLD") == "hello, w\u00f6rld");
+    CHECK (fold_utf8 ("CAFE\u0301") == "caf\u00e9");
+    CHECK (fold_utf8 ("\u0415\u0308\u0416") == "\u0451\u0436");
+    CHECK (fold_utf8 ("A\xff" "B") == "a\xff" "b");
+    CHECK (fold_utf8 ("abcdefghijklmnopqrstuvwxyZ\u0301") == "abcdefghijklmnopqrstuvwxy\u017a");
+}
+
+void
+search ()
+{
+    std::string_view text = "The cafe\u0301 of Solitude, the caf\u00e9 of Riften, "
+                            "\u0415\u0308\u043b\u043a\u0430";
+    CHECK (find_text_nocase (text, "CAF\u00c9") == 4);
+    CHECK (find_text_nocase (text, "caf\u00e9", 5) == 28);
+    CHECK (find_text_nocase (text, "CAFE\u0301 OF R") == 28);
+    CHECK (find_text_nocase (text, "\u00e9 of") == 7);
+    CHECK (find_text_nocase (text, "\u0451\u043b\u043a\u0430") == 45);
+    CHECK (find_text_nocase (text, "caf\u00e8") == std::string_view::npos);
+    CHECK (find_text_nocase (text, "SOLITUDE") == 14);
+}
+
+}
+
+//--------------------------------------------------------------------------------------------------
+
+int
+main ()
+{
+    decode ();
+    compose ();
+    fold ();
+    search ();
+    return check_failures;
+}
+
+//--------------------------------------------------------------------------------------------------